@@ -0,0 +1,44 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+__declspec(thread) int64 threadAllocations = 0;
+
+void* Allocate(size_t size)
+{
+    threadAllocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+
+    return p;
+}
+}
+
+int64 GetThreadAllocationCount()
+{
+    return threadAllocations;
+}
+
+//------------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+    return Allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return Allocate(size);
+}
+
+void operator delete(void* p)
+{
+    free(p);
+}
+
+void operator delete[](void* p)
+{
+    free(p);
+}
@@ -0,0 +1,14 @@
+#ifndef _ALLOCATION_COUNTER_H_
+#define _ALLOCATION_COUNTER_H_
+
+#include "third_party/chromium/base/basictypes.h"
+
+//------------------------------------------------------------------------------
+// Part of audio_quality_identification_unittests only, which it gives a
+// global operator new that counts the allocations of every thread. Lets a
+// test check that a loop stays off the heap.
+
+// Allocations made through operator new on the calling thread so far.
+int64 GetThreadAllocationCount();
+
+#endif  // _ALLOCATION_COUNTER_H_
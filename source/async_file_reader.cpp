@@ -0,0 +1,186 @@
+#include "async_file_reader.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <windows.h>
+
+using std::wstring;
+using std::min;
+
+namespace {
+// Reads in flight for one file. Keeps a few files streaming side by side
+// instead of one file hogging the whole queue.
+const int maxOutstandingPerFile = 4;
+}
+
+//------------------------------------------------------------------------------
+struct AsyncFileReader::Request
+{
+    explicit Request(int chunkSize) : StreamId(0), Buffer(chunkSize)
+    {
+        memset(&Overlapped, 0, sizeof(Overlapped));
+    }
+
+    // Has to come first, the completion port hands it back.
+    OVERLAPPED Overlapped;
+    int StreamId;
+    std::vector<char> Buffer;
+};
+
+AsyncFileReader::AsyncFileReader(int depth, int chunkSize)
+    : depth_(depth > 0 ? depth : 1)
+    , chunkSize_(chunkSize > 0 ? chunkSize : 64 * 1024)
+    , port_(NULL)
+    , streams_()
+    , requests_()
+    , idle_()
+    , nextId_(1)
+{
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    if (!port_)
+        return;
+
+    // The buffers must stay alive until the system is done with them.
+    for (auto i = streams_.begin(), e = streams_.end(); i != e; ++i)
+        i->second.Next = i->second.End;
+
+    while (idle_.size() < requests_.size())
+        Poll(INFINITE);
+
+    for (auto i = streams_.begin(), e = streams_.end(); i != e; ++i)
+        CloseHandle(i->second.File);
+
+    CloseHandle(port_);
+}
+
+bool AsyncFileReader::Init()
+{
+    assert(!port_);
+    port_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    if (!port_)
+        return false;
+
+    for (int i = 0; i < depth_; ++i) {
+        requests_.push_back(
+            std::shared_ptr<Request>(new Request(chunkSize_)));
+        idle_.push_back(requests_.back().get());
+    }
+
+    return true;
+}
+
+int AsyncFileReader::Add(const wstring& fullPathName, int64 bytes)
+{
+    assert(port_);
+    if (!port_ || (bytes <= 0))
+        return 0;
+
+    HANDLE file = CreateFile(
+        fullPathName.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
+
+    if (!CreateIoCompletionPort(file, port_, 0, 0)) {
+        CloseHandle(file);
+        return 0;
+    }
+
+    const int id = nextId_++;
+    Stream& stream = streams_[id];
+    stream.File = file;
+    stream.Next = 0;
+    stream.End = bytes;
+    stream.Outstanding = 0;
+    Issue(id, &stream);
+    return id;
+}
+
+void AsyncFileReader::Abort(int id)
+{
+    auto stream = streams_.find(id);
+    if (stream != streams_.end())
+        stream->second.Next = stream->second.End;
+}
+
+int AsyncFileReader::Poll(int timeout)
+{
+    assert(port_);
+    DWORD bytes = 0;
+    ULONG_PTR key = 0;
+    OVERLAPPED* overlapped = NULL;
+    const BOOL succeeded = GetQueuedCompletionStatus(port_, &bytes, &key,
+                                                     &overlapped, timeout);
+
+    // No overlapped structure means a timeout or a Wake().
+    if (overlapped)
+        Complete(reinterpret_cast<Request*>(overlapped), !!succeeded, bytes);
+
+    int done = 0;
+    for (auto i = streams_.begin(), e = streams_.end(); i != e; ++i) {
+        Issue(i->first, &i->second);
+        if (!done && !i->second.Outstanding &&
+            (i->second.Next >= i->second.End))
+            done = i->first;
+    }
+
+    if (done) {
+        CloseHandle(streams_[done].File);
+        streams_.erase(done);
+    }
+
+    return done;
+}
+
+void AsyncFileReader::Wake()
+{
+    if (port_)
+        PostQueuedCompletionStatus(port_, 0, 0, NULL);
+}
+
+void AsyncFileReader::Issue(int id, Stream* stream)
+{
+    while (!idle_.empty() && (stream->Outstanding < maxOutstandingPerFile) &&
+           (stream->Next < stream->End)) {
+        Request* request = idle_.back();
+        const int size = static_cast<int>(
+            min<int64>(chunkSize_, stream->End - stream->Next));
+        memset(&request->Overlapped, 0, sizeof(request->Overlapped));
+        request->Overlapped.Offset = static_cast<DWORD>(stream->Next);
+        request->Overlapped.OffsetHigh =
+            static_cast<DWORD>(stream->Next >> 32);
+        request->StreamId = id;
+
+        // Even a read that finishes right away is reported through the port.
+        if (!ReadFile(stream->File, &request->Buffer[0], size, NULL,
+                      &request->Overlapped) &&
+            (GetLastError() != ERROR_IO_PENDING)) {
+            stream->Next = stream->End;
+            break;
+        }
+
+        idle_.pop_back();
+        stream->Outstanding++;
+        stream->Next += size;
+    }
+}
+
+void AsyncFileReader::Complete(Request* request, bool succeeded,
+                               uint32 bytes)
+{
+    idle_.push_back(request);
+    auto stream = streams_.find(request->StreamId);
+    if (stream == streams_.end())
+        return;
+
+    stream->second.Outstanding--;
+
+    // Stop at the end of the file or at the first error.
+    if (!succeeded || !bytes)
+        stream->second.Next = stream->second.End;
+}
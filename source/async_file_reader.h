@@ -0,0 +1,74 @@
+#ifndef _ASYNC_FILE_READER_H_
+#define _ASYNC_FILE_READER_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/basictypes.h"
+
+//------------------------------------------------------------------------------
+// Reads the leading bytes of many files at once through overlapped I/O and a
+// single completion port, so that one thread keeps the disk queue full
+// instead of waiting on one blocking read after the other. Only meant to pull
+// files into the system cache, the data itself is thrown away.
+//
+// AudioQualityIdent::Identify() does not read through it. Its probe reads the
+// file through MappedFile and the decoder opens the file by name, both get
+// the bytes from the cache the Prefetcher filled, or from the disk if the
+// prefetcher has not got to the file yet.
+//
+// Everything except Wake() has to be called from the same thread.
+class AsyncFileReader
+{
+public:
+    // At most |depth| reads of |chunkSize| bytes are in flight at any time.
+    AsyncFileReader(int depth, int chunkSize);
+    ~AsyncFileReader();
+
+    // Fails when no completion port can be created, the caller should read
+    // synchronously then.
+    bool Init();
+
+    // Starts reading the first |bytes| of the file. Returns 0 on failure,
+    // otherwise an id that Poll() reports once the file is done.
+    int Add(const std::wstring& fullPathName, int64 bytes);
+
+    // No further reads are issued for |id|. Reads in flight still complete.
+    void Abort(int id);
+
+    int GetActiveCount() const { return static_cast<int>(streams_.size()); }
+
+    // Waits up to |timeout| milliseconds for a read to complete, and issues
+    // the next ones. Returns the id of a file that is done, or 0.
+    int Poll(int timeout);
+
+    // Makes a pending Poll() return early. May be called from any thread.
+    void Wake();
+
+private:
+    struct Request;
+    struct Stream
+    {
+        void* File;
+        int64 Next;
+        int64 End;
+        int Outstanding;
+    };
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncFileReader);
+
+    void Issue(int id, Stream* stream);
+    void Complete(Request* request, bool succeeded, uint32 bytes);
+
+    int depth_;
+    int chunkSize_;
+    void* port_;
+    std::map<int, Stream> streams_;
+    std::vector<std::shared_ptr<Request>> requests_;
+    std::vector<Request*> idle_;
+    int nextId_;
+};
+
+#endif  // _ASYNC_FILE_READER_H_
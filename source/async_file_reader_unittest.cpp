@@ -0,0 +1,120 @@
+#include "async_file_reader.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include "third_party/chromium/base/file_util.h"
+#include "third_party/chromium/base/scoped_temp_dir.h"
+#include "third_party/chromium/base/string_number_conversions.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::set;
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace {
+const int chunkSize = 4096;
+
+class AsyncFileReaderTest : public testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_TRUE(tempDir_.CreateUniqueTempDir());
+    }
+
+    wstring CreateTestFile(int index, int size)
+    {
+        const FilePath file =
+            tempDir_.path().Append(base::IntToString16(index) + L".mp3");
+        const string content(size, 'x');
+        EXPECT_EQ(size, file_util::WriteFile(file, content.data(), size));
+        return file.value();
+    }
+
+    // Polls until |ids| have all been reported, each of them once.
+    void ExpectDone(AsyncFileReader* reader, set<int> ids)
+    {
+        while (!ids.empty()) {
+            const int id = reader->Poll(INFINITE);
+            ASSERT_NE(0, id);
+            ASSERT_EQ(1u, ids.erase(id)) << "id " << id;
+        }
+
+        EXPECT_EQ(0, reader->GetActiveCount());
+    }
+
+    ScopedTempDir tempDir_;
+};
+}
+
+// More files than reads in flight, of sizes around the chunk size, some
+// asked for beyond their end.
+TEST_F(AsyncFileReaderTest, ReadsEveryFile)
+{
+    AsyncFileReader reader(4, chunkSize);
+    ASSERT_TRUE(reader.Init());
+    set<int> ids;
+    for (int i = 0; i < 20; ++i) {
+        const int size = i * chunkSize / 3 + i % 2;
+        const wstring file = CreateTestFile(i, size);
+        const int id = reader.Add(file, size + (i % 3) * 100);
+        if (!size) {
+            EXPECT_EQ(0, id);
+            continue;
+        }
+
+        ASSERT_NE(0, id);
+        ids.insert(id);
+    }
+
+    ExpectDone(&reader, ids);
+}
+
+TEST_F(AsyncFileReaderTest, RejectsMissingFile)
+{
+    AsyncFileReader reader(4, chunkSize);
+    ASSERT_TRUE(reader.Init());
+    EXPECT_EQ(0, reader.Add(
+        tempDir_.path().Append(L"missing.mp3").value(), chunkSize));
+    EXPECT_EQ(0, reader.GetActiveCount());
+}
+
+TEST_F(AsyncFileReaderTest, Abort)
+{
+    AsyncFileReader reader(2, chunkSize);
+    ASSERT_TRUE(reader.Init());
+    const int size = 256 * chunkSize;
+    const int id = reader.Add(CreateTestFile(0, size), size);
+    ASSERT_NE(0, id);
+    reader.Abort(id);
+
+    set<int> ids;
+    ids.insert(id);
+    ExpectDone(&reader, ids);
+}
+
+TEST_F(AsyncFileReaderTest, Wake)
+{
+    AsyncFileReader reader(2, chunkSize);
+    ASSERT_TRUE(reader.Init());
+    reader.Wake();
+    EXPECT_EQ(0, reader.Poll(INFINITE));
+}
+
+// Destroying the reader with reads in flight must wait for them.
+TEST_F(AsyncFileReaderTest, DestroyWhileReading)
+{
+    vector<wstring> files;
+    for (int i = 0; i < 8; ++i)
+        files.push_back(CreateTestFile(i, 64 * chunkSize));
+
+    AsyncFileReader reader(8, chunkSize);
+    ASSERT_TRUE(reader.Init());
+    for (auto i = files.begin(), e = files.end(); i != e; ++i)
+        EXPECT_NE(0, reader.Add(*i, 64 * chunkSize));
+}
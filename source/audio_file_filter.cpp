@@ -0,0 +1,127 @@
+#include "audio_file_filter.h"
+
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+#include "third_party/chromium/base/file_path.h"
+#include "third_party/chromium/base/platform_file.h"
+
+using std::wstring;
+using std::set;
+using std::vector;
+using boost::algorithm::to_lower_copy;
+using boost::filesystem::path;
+
+namespace {
+// Enough for the longest signature below, the ASF header GUID.
+const int sniffSize = 16;
+
+void ParseExtensions(const wstring& list, set<wstring>* extensions)
+{
+    vector<wstring> items;
+    boost::algorithm::split(items, list, boost::algorithm::is_any_of(L";,"));
+    for (auto i = items.begin(), e = items.end(); i != e; ++i) {
+        wstring item = to_lower_copy(boost::algorithm::trim_copy(*i));
+        if (!item.empty() && (item[0] == L'.'))
+            item.erase(0, 1);
+
+        if (!item.empty())
+            extensions->insert(item);
+    }
+}
+
+bool StartsWith(const uint8* header, int size, int offset,
+                const char* signature)
+{
+    const int length = static_cast<int>(strlen(signature));
+    return (size >= offset + length) &&
+        !memcmp(header + offset, signature, length);
+}
+}
+
+AudioFileFilter::AudioFileFilter(const wstring& allowedExtensions,
+                                 const wstring& deniedExtensions)
+    : allowed_()
+    , denied_()
+{
+    ParseExtensions(allowedExtensions, &allowed_);
+    ParseExtensions(deniedExtensions, &denied_);
+}
+
+AudioFileFilter::~AudioFileFilter()
+{
+}
+
+bool AudioFileFilter::Accept(const wstring& fullPathName) const
+{
+    const Verdict verdict = CheckExtension(fullPathName);
+    if (verdict != kUnsure)
+        return verdict == kAccepted;
+
+    return Sniff(fullPathName) == kAccepted;
+}
+
+AudioFileFilter::Verdict AudioFileFilter::CheckExtension(
+    const wstring& fullPathName) const
+{
+    wstring extension = to_lower_copy(path(fullPathName).extension().wstring());
+    if (!extension.empty())
+        extension.erase(0, 1);
+
+    if (denied_.count(extension))
+        return kRejected;
+
+    if (allowed_.count(extension))
+        return kAccepted;
+
+    return kUnsure;
+}
+
+AudioFileFilter::Verdict AudioFileFilter::Sniff(const wstring& fullPathName)
+{
+    base::PlatformFile file = base::CreatePlatformFile(
+        FilePath(fullPathName),
+        base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_READ, NULL, NULL);
+    if (file == base::kInvalidPlatformFileValue)
+        return kUnsure;
+
+    uint8 header[sniffSize];
+    const int read = base::ReadPlatformFile(
+        file, 0, reinterpret_cast<char*>(header), sizeof(header));
+    base::ClosePlatformFile(file);
+    if (read < 0)
+        return kUnsure;
+
+    return IsAudioHeader(header, read) ? kAccepted : kRejected;
+}
+
+bool AudioFileFilter::IsAudioHeader(const uint8* header, int size)
+{
+    if (StartsWith(header, size, 0, "ID3") ||
+        StartsWith(header, size, 0, "fLaC") ||
+        StartsWith(header, size, 0, "OggS") ||
+        StartsWith(header, size, 0, "MAC ") ||
+        StartsWith(header, size, 0, "wvpk") ||
+        StartsWith(header, size, 4, "ftyp"))
+        return true;
+
+    if (StartsWith(header, size, 0, "RIFF") &&
+        StartsWith(header, size, 8, "WAVE"))
+        return true;
+
+    // ASF, i.e. WMA.
+    const uint8 asfGuid[] = {
+        0x30, 0x26, 0xB2, 0x75, 0x8E, 0x66, 0xCF, 0x11,
+        0xA6, 0xD9, 0x00, 0xAA, 0x00, 0x62, 0xCE, 0x6C
+    };
+    if ((size >= static_cast<int>(sizeof(asfGuid))) &&
+        !memcmp(header, asfGuid, sizeof(asfGuid)))
+        return true;
+
+    // An MPEG audio frame without a tag in front: 11 sync bits, a valid
+    // version and layer.
+    return (size >= 2) && (header[0] == 0xFF) && ((header[1] & 0xE0) == 0xE0) &&
+        ((header[1] & 0x18) != 0x08) && ((header[1] & 0x06) != 0x00);
+}
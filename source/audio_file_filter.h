@@ -0,0 +1,51 @@
+#ifndef _AUDIO_FILE_FILTER_H_
+#define _AUDIO_FILE_FILTER_H_
+
+#include <set>
+#include <string>
+
+#include "third_party/chromium/base/basictypes.h"
+
+//------------------------------------------------------------------------------
+// Decides at traversal time whether a file is worth handing to the decoder.
+// A denied extension is dropped and an allowed one is taken right away. Any
+// other file is taken only if its first bytes look like an audio container,
+// so that cover art, cue sheets and logs never reach the decoder or the
+// store. The lists are separated by ';' or ',' and compared without case.
+class AudioFileFilter
+{
+public:
+    AudioFileFilter(const std::wstring& allowedExtensions,
+                    const std::wstring& deniedExtensions);
+    ~AudioFileFilter();
+
+    enum Verdict
+    {
+        kAccepted,
+        kRejected,
+
+        // The extension is on neither list and Sniff() decides, or Sniff()
+        // could not read the file.
+        kUnsure
+    };
+
+    bool Accept(const std::wstring& fullPathName) const;
+
+    // The two halves of Accept(). The first only looks at the name, the
+    // second reads the start of the file, which is what makes a scan of a
+    // cold or remote archive slow.
+    Verdict CheckExtension(const std::wstring& fullPathName) const;
+    static Verdict Sniff(const std::wstring& fullPathName);
+
+    // Whether |header|, the first |size| bytes of a file, starts with the
+    // signature of an audio format the decoders read.
+    static bool IsAudioHeader(const uint8* header, int size);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(AudioFileFilter);
+
+    std::set<std::wstring> allowed_;
+    std::set<std::wstring> denied_;
+};
+
+#endif  // _AUDIO_FILE_FILTER_H_
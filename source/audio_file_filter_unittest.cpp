@@ -0,0 +1,113 @@
+#include "audio_file_filter.h"
+
+#include <fstream>
+#include <string>
+
+#include "third_party/chromium/base/scoped_temp_dir.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::ofstream;
+using std::string;
+using std::wstring;
+
+namespace {
+bool IsAudioHeader(const string& header)
+{
+    return AudioFileFilter::IsAudioHeader(
+        reinterpret_cast<const uint8*>(header.data()),
+        static_cast<int>(header.size()));
+}
+
+void WriteFile(const wstring& fullPathName, const string& bytes)
+{
+    ofstream file(fullPathName.c_str(), std::ios::binary);
+    file.write(bytes.data(), bytes.size());
+}
+}
+
+TEST(AudioFileFilterTest, IsAudioHeader)
+{
+    EXPECT_TRUE(IsAudioHeader(string("ID3\x04\0\0\0\0\0\0", 10)));
+    EXPECT_TRUE(IsAudioHeader(string("fLaC\0\0\0\x22", 8)));
+    EXPECT_TRUE(IsAudioHeader("OggS"));
+    EXPECT_TRUE(IsAudioHeader("MAC \x96\x0f"));
+    EXPECT_TRUE(IsAudioHeader("wvpk"));
+    EXPECT_TRUE(IsAudioHeader(string("\0\0\0\x20" "ftypM4A ", 12)));
+    EXPECT_TRUE(IsAudioHeader(string("RIFF\x24\x08\0\0WAVEfmt ", 16)));
+    EXPECT_TRUE(IsAudioHeader(string(
+        "\x30\x26\xB2\x75\x8E\x66\xCF\x11\xA6\xD9\x00\xAA\x00\x62\xCE\x6C",
+        16)));
+
+    // MPEG-1 layer III and MPEG-2 layer II frames without a tag.
+    EXPECT_TRUE(IsAudioHeader("\xFF\xFB\x90\x64"));
+    EXPECT_TRUE(IsAudioHeader("\xFF\xF4\x90\x64"));
+}
+
+TEST(AudioFileFilterTest, IsNotAudioHeader)
+{
+    EXPECT_FALSE(IsAudioHeader(""));
+    EXPECT_FALSE(IsAudioHeader("\xFF\xD8\xFF\xE0"));
+    EXPECT_FALSE(IsAudioHeader("\x89PNG\r\n\x1a\n"));
+    EXPECT_FALSE(IsAudioHeader("REM GENRE Rock\r\n"));
+    EXPECT_FALSE(IsAudioHeader(string("RIFF\x24\x08\0\0AVI LIST", 16)));
+    EXPECT_FALSE(IsAudioHeader(string("\0\0\0\x20" "fty", 7)));
+
+    // Cut off before the end of the signature.
+    EXPECT_FALSE(IsAudioHeader("fLa"));
+    EXPECT_FALSE(IsAudioHeader(string("RIFF\x24\x08\0\0WAV", 11)));
+    EXPECT_FALSE(IsAudioHeader(string(
+        "\x30\x26\xB2\x75\x8E\x66\xCF\x11\xA6\xD9\x00\xAA\x00\x62\xCE", 15)));
+
+    // Sync bits with the reserved version, the reserved layer, or too few
+    // of them.
+    EXPECT_FALSE(IsAudioHeader("\xFF\xEB"));
+    EXPECT_FALSE(IsAudioHeader("\xFF\xF9"));
+    EXPECT_FALSE(IsAudioHeader("\xFF\xDB"));
+    EXPECT_FALSE(IsAudioHeader("\xFF"));
+}
+
+TEST(AudioFileFilterTest, CheckExtension)
+{
+    AudioFileFilter filter(L"mp3; .FLAC ,ape", L"jpg;.cue;LOG");
+    EXPECT_EQ(AudioFileFilter::kAccepted,
+              filter.CheckExtension(L"C:\\music\\a.mp3"));
+    EXPECT_EQ(AudioFileFilter::kAccepted,
+              filter.CheckExtension(L"C:\\music\\a.Flac"));
+    EXPECT_EQ(AudioFileFilter::kAccepted,
+              filter.CheckExtension(L"C:\\music\\a.APE"));
+    EXPECT_EQ(AudioFileFilter::kRejected,
+              filter.CheckExtension(L"C:\\music\\cover.JPG"));
+    EXPECT_EQ(AudioFileFilter::kRejected,
+              filter.CheckExtension(L"C:\\music\\a.cue"));
+    EXPECT_EQ(AudioFileFilter::kRejected,
+              filter.CheckExtension(L"C:\\music\\a.log"));
+    EXPECT_EQ(AudioFileFilter::kUnsure,
+              filter.CheckExtension(L"C:\\music\\a.wav"));
+    EXPECT_EQ(AudioFileFilter::kUnsure,
+              filter.CheckExtension(L"C:\\music\\README"));
+}
+
+TEST(AudioFileFilterTest, Sniff)
+{
+    ScopedTempDir tempDir;
+    ASSERT_TRUE(tempDir.CreateUniqueTempDir());
+    const wstring audio = tempDir.path().Append(L"track.dat").value();
+    const wstring image = tempDir.path().Append(L"cover.dat").value();
+    const wstring empty = tempDir.path().Append(L"empty.dat").value();
+    WriteFile(audio, string("fLaC\0\0\0\x22", 8));
+    WriteFile(image, "\xFF\xD8\xFF\xE0");
+    WriteFile(empty, "");
+
+    EXPECT_EQ(AudioFileFilter::kAccepted, AudioFileFilter::Sniff(audio));
+    EXPECT_EQ(AudioFileFilter::kRejected, AudioFileFilter::Sniff(image));
+    EXPECT_EQ(AudioFileFilter::kRejected, AudioFileFilter::Sniff(empty));
+    EXPECT_EQ(AudioFileFilter::kUnsure, AudioFileFilter::Sniff(
+        tempDir.path().Append(L"missing.dat").value()));
+
+    // The extension decides first.
+    AudioFileFilter filter(L"", L"dat");
+    EXPECT_FALSE(filter.Accept(audio));
+    AudioFileFilter sniffing(L"", L"");
+    EXPECT_TRUE(sniffing.Accept(audio));
+    EXPECT_FALSE(sniffing.Accept(image));
+}
@@ -1,11 +1,13 @@
 #include "audio_quality_ident.h"
 
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
-#include <boost/filesystem.hpp>
-#include <windows.h>
-
+#include "decoder_backend.h"
+#include "mapped_file.h"
+#include "pcm_spectrum_engine.h"
+#include "window_positions.h"
 #include "third_party/multimedia_core/player_interface.h"
 #include "third_party/multimedia_core/audio_information_extracter_interface.h"
 #include "third_party/multimedia_core/audio_spectrum_extracter_interface.h"
@@ -13,64 +15,57 @@
 
 using std::unique_ptr;
 using std::wstring;
-using std::ifstream;
 using std::vector;
-using std::max;
 using std::shared_ptr;
-using boost::filesystem::path;
+using std::min;
 using base::CancellationFlag;
 
 namespace {
-typedef unique_ptr<void, void (__stdcall*)(void*)> FuncHostType;
-typedef HRESULT (__stdcall* MMCoreFactoryProc)(ICorePlayer** , void*);
-typedef HRESULT (__stdcall* AudioInfoExtrFactoryProc)(
-    IAudioInformationExtracter**);
-
-bool LoadMultiMediaCoreFunctions(
-    FuncHostType* funcHost, scoped_refptr<ICorePlayer>* mediaInfo,
-    scoped_refptr<IAudioInformationExtracter>* spectrumSource)
+// GetInstantMediaInfo() only needs the container headers, which all formats we
+// know of keep near the beginning of the file. ID3v1 and APEv2 tags live at
+// the very end, so a small tail window is appended to the probe as well. A
+// file still unrecognized at |maxProbeSize| is probed whole.
+const int initialProbeSize = 256 * 1024;
+const int maxProbeSize = 8 * 1024 * 1024;
+const int tailProbeSize = 16 * 1024;
+
+// The beginning and the end of a track are excluded from the cutoff analysis.
+const double analysisOffset = 10.0;
+const double analysisTail = 10.0;
+const int64 durationUnitsPerSecond = 10000000;
+
+const int spectrumWindowSize = 1024;
+
+// A receiver turns a bin index into Hz as (index + 1) * (sampleRate / 2) in
+// int, which holds for this many bins up to 384 kHz.
+const int maxFftSize = 16384;
+const int checkPointInterval = 20;
+
+// kAllChannels stops at this many, more are hardly ever distinct content.
+const int maxSpectrumSources = 8;
+
+// A silent or nearly silent source, e.g. the side of a mono recording, has
+// no step in its spectrum and yields a meaningless cutoff near 0 Hz.
+const int minSourceCutoff = 2000;
+
+// Checkpoints a receiver holds without growing, about 8 minutes of 44.1 kHz.
+const int initialCheckPoints = 1024;
+
+// Reads the first |prefixSize| bytes of the file followed by its last
+// |tailProbeSize| bytes into |buf|. A file that is not larger than that is
+// read whole.
+bool ReadProbe(const MappedFile& file, int64 prefixSize, vector<int8>* buf)
 {
-    // We need multimedia core to help accomplish the work.
-    unique_ptr<wchar_t[]> buf(new wchar_t[MAX_PATH]);
-    GetModuleFileName(NULL, buf.get(), MAX_PATH);
-    path p(buf.get());
-    wstring location = p.remove_filename().wstring() + L"/kgplayer.dll";
-    FuncHostType dll(LoadLibrary(location.c_str()),
-                     reinterpret_cast<void (__stdcall*)(void*)>(FreeLibrary));
-    if (!dll)
-        return false;
-
-    // Export all necessary functions.
-    MMCoreFactoryProc mmCoreFactoryProc =
-        reinterpret_cast<MMCoreFactoryProc>(
-            GetProcAddress(reinterpret_cast<HMODULE>(dll.get()),
-                           reinterpret_cast<char*>(3)));
-    if (!mmCoreFactoryProc)
-        return false;
-
-    AudioInfoExtrFactoryProc audioInfoExtrFactoryProc =
-        reinterpret_cast<AudioInfoExtrFactoryProc>(
-            GetProcAddress(reinterpret_cast<HMODULE>(dll.get()),
-                           reinterpret_cast<char*>(7)));
-    if (!audioInfoExtrFactoryProc)
-        return false;
-
-    scoped_refptr<ICorePlayer> interface1;
-    HRESULT r = mmCoreFactoryProc(reinterpret_cast<ICorePlayer**>(&interface1),
-                                  NULL);
-    if (FAILED(r))
-        return false;
-
-    scoped_refptr<IAudioInformationExtracter> interface2;
-    r = audioInfoExtrFactoryProc(
-        reinterpret_cast<IAudioInformationExtracter**>(&interface2));
-    if (FAILED(r))
-        return false;
+    const int64 fileSize = file.GetSize();
+    if (fileSize <= prefixSize + tailProbeSize) {
+        buf->resize(static_cast<size_t>(fileSize));
+        return file.Read(0, fileSize, &(*buf)[0]);
+    }
 
-    funcHost->swap(dll);
-    *mediaInfo = interface1;
-    *spectrumSource = interface2;
-    return true;
+    buf->resize(static_cast<size_t>(prefixSize + tailProbeSize));
+    return file.Read(0, prefixSize, &(*buf)[0]) &&
+        file.Read(fileSize - tailProbeSize, tailProbeSize,
+                  &(*buf)[static_cast<size_t>(prefixSize)]);
 }
 
 class PassString : public kugou::CUnknown, public IPassString
@@ -93,46 +88,108 @@ private:
 class MySpectrumReceiver : public kugou::CUnknown, public IAudioSpectrumReceiver
 {
 public:
-    MySpectrumReceiver(int sampleRate,
+    MySpectrumReceiver(CutoffDetector::Type detectorType,
+                       int convergenceTolerance, int convergenceCheckPoints,
                        const shared_ptr<base::CancellationFlag>& cancelFlag);
     virtual ~MySpectrumReceiver() {}
 
     DELEGATE_IUNKNOWN;
     virtual bool __stdcall Receive(IAudioSpectrum* samples);
 
-    int GetAverageFreq()
+    // Prepares the receiver for the next file. Buffers keep their capacity.
+    void Reset(int sampleRate);
+
+    // Number of times one of the buffers had to grow.
+    int GetGrowthCount() const { return growthCount_; }
+
+    // Discards a partial checkpoint interval and makes Receive() stop the
+    // extraction after |frames| frames.
+    void StartWindow(int frames)
     {
-        vector<int> freqs = freqs_;
+        if (bins_)
+            detector_->Reset(bins_);
 
-        // Exclude some data at the end(about 10 sec).
-        int toRemove = 10;
-        while (freqs.size() && (toRemove-- >= 0))
-            freqs.pop_back();
+        receiveCount_ = 1;
+        frameBudget_ = frames;
+    }
+
+    bool IsConverged() const { return converged_; }
+
+    int GetAverageFreq(bool excludeTail) const
+    {
+        // Exclude some data at the end(about 10 sec). An extraction stopped
+        // by convergence never got there.
+        const int toRemove = (excludeTail && !converged_) ? 11 : 0;
+        const int count = static_cast<int>(freqs_.size()) - toRemove;
+        if (count <= 0)
+            return 0;
 
         double sum = 0.0;
-        for (auto i = freqs.begin(), e = freqs.end(); i != e; ++i)
-            sum += *i;
+        for (int i = 0; i < count; ++i)
+            sum += freqs_[i];
 
-        return freqs.empty() ? 0 : static_cast<int>(sum / freqs.size());
+        return static_cast<int>(sum / count);
     }
 
 private:
+    void UpdateEstimate(int freq);
+
     int receiveCount_;
-    unique_ptr<double[]> power_;
+    int frameBudget_;
+    int bins_;
+    int maxBins_;
+    int growthCount_;
+    unique_ptr<CutoffDetector> detector_;
     vector<int> freqs_;
     int sampleRate_;
+
+    // Running mean and sum of squared deviations of the checkpoint cutoffs.
+    double mean_;
+    double squaredDeviations_;
+    int stableCheckPoints_;
+    int convergenceTolerance_;
+    int convergenceCheckPoints_;
+    bool converged_;
     std::shared_ptr<base::CancellationFlag> cancelFlag_;
 };
 
 MySpectrumReceiver::MySpectrumReceiver(
-    int sampleRate, const shared_ptr<base::CancellationFlag>& cancelFlag)
+    CutoffDetector::Type detectorType, int convergenceTolerance,
+    int convergenceCheckPoints,
+    const shared_ptr<base::CancellationFlag>& cancelFlag)
     : kugou::CUnknown(NULL, NULL)
     , receiveCount_(1)
-    , power_()
+    , frameBudget_(0)
+    , bins_(0)
+    , maxBins_(0)
+    , growthCount_(0)
+    , detector_(CutoffDetector::Create(detectorType))
     , freqs_()
-    , sampleRate_(sampleRate)
+    , sampleRate_(0)
+    , mean_(0.0)
+    , squaredDeviations_(0.0)
+    , stableCheckPoints_(0)
+    , convergenceTolerance_(convergenceTolerance)
+    , convergenceCheckPoints_(convergenceCheckPoints)
+    , converged_(false)
     , cancelFlag_(cancelFlag)
 {
+    freqs_.reserve(initialCheckPoints);
+}
+
+void MySpectrumReceiver::Reset(int sampleRate)
+{
+    if (bins_)
+        detector_->Reset(bins_);
+
+    receiveCount_ = 1;
+    frameBudget_ = 0;
+    freqs_.clear();
+    sampleRate_ = sampleRate;
+    mean_ = 0.0;
+    squaredDeviations_ = 0.0;
+    stableCheckPoints_ = 0;
+    converged_ = false;
 }
 
 bool MySpectrumReceiver::Receive(IAudioSpectrum* spectrum)
@@ -145,54 +202,198 @@ bool MySpectrumReceiver::Receive(IAudioSpectrum* spectrum)
     if (amount <= 1)
         return false;
 
-    if (!power_.get()) {
-        power_.reset(new double[amount]);
-        for (int i = 0; i < amount; ++i)
-            power_[i] = 0.0;
-    }
+    if (bins_ != amount) {
+        if (amount > maxBins_) {
+            growthCount_++;
+            maxBins_ = amount;
+        }
 
-    for (int i = 0; i < amount; ++i) {
-        const double d = 10 * log(static_cast<double>(ptr[i]));
-//         if (d > 0.0)
-//             power_[i] += d;
-        power_[i] = max(power_[i], d);
+        detector_->Reset(amount);
+        bins_ = amount;
     }
 
-    const int checkPointInterval = 20;
+    detector_->Accumulate(ptr);
+
     const bool checkPoint = !!(receiveCount_++ % checkPointInterval);
     if (!checkPoint) {
-//         for (int i = amount - 1; i >= 0; --i)
-//             power_[i] /= 20;
-
-        double prev = power_[amount - 1];
-        int cutOffFreqIndex = 0;
-        for (int i = amount - 2; i >= 0; --i) {
-            double diff = abs(prev - power_[i]);
-            if (diff > 3.0) {
-                cutOffFreqIndex = i;
-                break;
-            }
-
-            prev = power_[i];
-        }
-
+        const int cutOffFreqIndex = detector_->FindCutoffIndex();
         int freq = (cutOffFreqIndex + 1) * (sampleRate_ / 2) / (amount - 1);
+        if (freqs_.size() == freqs_.capacity())
+            growthCount_++;
+
         freqs_.push_back(freq);
+        detector_->Reset(amount);
+
+        UpdateEstimate(freq);
+        if (converged_)
+            return false;
+    }
+
+    if (frameBudget_ > 0)
+        return --frameBudget_ > 0;
+
+    return true;
+}
+
+// The estimate counts as converged once, for |convergenceCheckPoints_|
+// checkpoints in a row, neither a new checkpoint moved the mean nor the
+// standard error of the mean exceeded the tolerance.
+void MySpectrumReceiver::UpdateEstimate(int freq)
+{
+    if ((convergenceTolerance_ <= 0) || (convergenceCheckPoints_ <= 0))
+        return;
+
+    // Welford's online update.
+    const double n = static_cast<double>(freqs_.size());
+    const double prevMean = mean_;
+    mean_ += (freq - prevMean) / n;
+    squaredDeviations_ += (freq - prevMean) * (freq - mean_);
+
+    if (n < 2)
+        return;
+
+    const double standardError = sqrt(squaredDeviations_ / (n - 1) / n);
+    const bool stable =
+        (fabs(mean_ - prevMean) <= convergenceTolerance_) &&
+        (standardError <= convergenceTolerance_);
+    stableCheckPoints_ = stable ? stableCheckPoints_ + 1 : 0;
+    converged_ = stableCheckPoints_ >= convergenceCheckPoints_;
+}
+}
+
+//------------------------------------------------------------------------------
+// Everything Identify() needs besides the decoder. Owned by one worker and
+// reused for every file, so that once the worker has seen its largest file
+// none of it grows any more. pcm_spectrum_engine_unittest checks that the
+// per-frame analysis then stays off the heap.
+class AudioQualityIdent::AnalysisContext
+{
+public:
+    AnalysisContext(const Options& options,
+                    const shared_ptr<CancellationFlag>& cancelFlag);
+
+    // Returns |count| receivers, reset for a file of |sampleRate|.
+    IAudioSpectrumReceiver** PrepareReceivers(int count, int sampleRate);
+
+    void StartWindow(int frames);
+    bool IsConverged() const;
+
+    // The lowest cutoff among the sources that have one.
+    int GetLowestFreq(bool excludeTail) const;
+
+    vector<int>* GetSources() { return &sources_; }
+    vector<double>* GetPositions() { return &positions_; }
+    vector<int8>* GetProbeBuffer() { return &probeBuf_; }
+
+    // Accounts for a pooled buffer whose capacity went from |before| to
+    // |after| outside of the context.
+    void CountGrowth(size_t before, size_t after)
+    {
+        if (after != before)
+            growthCount_++;
+    }
+
+    int64 GetGrowthCount() const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(AnalysisContext);
+
+    CutoffDetector::Type detectorType_;
+    int convergenceTolerance_;
+    int convergenceCheckPoints_;
+    shared_ptr<CancellationFlag> cancelFlag_;
+    vector<scoped_refptr<MySpectrumReceiver>> receivers_;
+    vector<IAudioSpectrumReceiver*> receiverPtrs_;
+    int activeCount_;
+    vector<int> sources_;
+    vector<double> positions_;
+    vector<int8> probeBuf_;
+    int64 growthCount_;
+};
+
+AudioQualityIdent::AnalysisContext::AnalysisContext(
+    const Options& options, const shared_ptr<CancellationFlag>& cancelFlag)
+    : detectorType_(options.Detector)
+    , convergenceTolerance_(options.ConvergenceTolerance)
+    , convergenceCheckPoints_(options.ConvergenceCheckPoints)
+    , cancelFlag_(cancelFlag)
+    , receivers_()
+    , receiverPtrs_()
+    , activeCount_(0)
+    , sources_()
+    , positions_()
+    , probeBuf_()
+    , growthCount_(0)
+{
+}
+
+IAudioSpectrumReceiver** AudioQualityIdent::AnalysisContext::PrepareReceivers(
+    int count, int sampleRate)
+{
+    assert(count > 0);
+    while (static_cast<int>(receivers_.size()) < count) {
+        receivers_.push_back(
+            new MySpectrumReceiver(detectorType_, convergenceTolerance_,
+                                   convergenceCheckPoints_, cancelFlag_));
+        receiverPtrs_.push_back(receivers_.back().get());
+        growthCount_++;
+    }
+
+    activeCount_ = count;
+    for (int i = 0; i < activeCount_; ++i)
+        receivers_[i]->Reset(sampleRate);
+
+    return &receiverPtrs_[0];
+}
+
+void AudioQualityIdent::AnalysisContext::StartWindow(int frames)
+{
+    for (int i = 0; i < activeCount_; ++i)
+        receivers_[i]->StartWindow(frames);
+}
 
-        for (int i = 0; i < amount; ++i)
-            power_[i] = 0.0;
+bool AudioQualityIdent::AnalysisContext::IsConverged() const
+{
+    for (int i = 0; i < activeCount_; ++i) {
+        if (!receivers_[i]->IsConverged())
+            return false;
     }
 
     return true;
 }
+
+int AudioQualityIdent::AnalysisContext::GetLowestFreq(bool excludeTail) const
+{
+    int lowest = 0;
+    for (int i = 0; i < activeCount_; ++i) {
+        const int freq = receivers_[i]->GetAverageFreq(excludeTail);
+        if ((freq >= minSourceCutoff) && (!lowest || (freq < lowest)))
+            lowest = freq;
+    }
+
+    // With a single source there is nothing to choose from.
+    return (lowest || (activeCount_ > 1)) ?
+        lowest : receivers_[0]->GetAverageFreq(excludeTail);
+}
+
+int64 AudioQualityIdent::AnalysisContext::GetGrowthCount() const
+{
+    int64 count = growthCount_;
+    for (auto i = receivers_.begin(), e = receivers_.end(); i != e; ++i)
+        count += (*i)->GetGrowthCount();
+
+    return count;
 }
 
+//------------------------------------------------------------------------------
 AudioQualityIdent::AudioQualityIdent(
-    const shared_ptr<CancellationFlag>& cancelFlag)
-    : funcHost_(NULL, reinterpret_cast<void (__stdcall*)(void*)>(FreeLibrary))
-    , mediaInfo_()
+    const Options& options, const shared_ptr<CancellationFlag>& cancelFlag)
+    : backend_()
     , spectrumSource_()
+    , options_(options)
     , cancelFlag_(cancelFlag)
+    , spectrumEngine_()
+    , context_(new AnalysisContext(options, cancelFlag))
 {
 }
 
@@ -202,15 +403,32 @@ AudioQualityIdent::~AudioQualityIdent()
 
 bool AudioQualityIdent::Init()
 {
-    return LoadMultiMediaCoreFunctions(&funcHost_, &mediaInfo_,
-                                       &spectrumSource_);
+    backend_.reset(DecoderBackend::Create(options_.Backend,
+                                          options_.DecoderLatency));
+    if (!backend_->Init())
+        return false;
+
+    spectrumSource_ = backend_->GetExtracter();
+
+    if ((options_.Engine == IdentificationModes::kNativeSpectrum) ||
+        (options_.Channels == IdentificationModes::kMidSide) ||
+        (options_.Channels == IdentificationModes::kDownmix)) {
+        int fftSize = options_.FftSize;
+        if ((fftSize < 64) || (fftSize > maxFftSize) ||
+            (fftSize & (fftSize - 1)))
+            fftSize = spectrumWindowSize;
+
+        spectrumEngine_ = new PcmSpectrumEngine(fftSize, options_.FftOverlap);
+    }
+
+    return true;
 }
 
 bool AudioQualityIdent::Identify(const wstring& fullPathName, int* sampleRate,
                                  int* bitrate, int* channels, int* cutoff,
                                  int64* duration, wstring* format)
 {
-    assert(mediaInfo_);
+    assert(backend_);
     assert(spectrumSource_);
     assert(sampleRate);
     assert(bitrate);
@@ -218,7 +436,7 @@ bool AudioQualityIdent::Identify(const wstring& fullPathName, int* sampleRate,
     assert(cutoff);
     assert(duration);
     assert(format);
-    if (!mediaInfo_ || !spectrumSource_ || !sampleRate || !bitrate ||
+    if (!backend_ || !spectrumSource_ || !sampleRate || !bitrate ||
         !channels || !cutoff || !duration || !format)
         return false;
 
@@ -230,19 +448,46 @@ bool AudioQualityIdent::Identify(const wstring& fullPathName, int* sampleRate,
     *duration = 0;
     *format = unknownFormat;
 
-    ifstream audioFile(fullPathName.c_str(), std::ios::binary);
-    audioFile.seekg(0, std::ios::end);
-    int fileSize = static_cast<int>(audioFile.tellg());
-    if (fileSize > 0) {
-        unique_ptr<int8[]> buf(new int8[fileSize]);
-        audioFile.seekg(0);
-        audioFile.read(reinterpret_cast<char*>(buf.get()), fileSize);
+    MappedFile audioFile;
+    if (!audioFile.Open(fullPathName))
+        return false;
 
-        // Retrieve all necessary media information.
+    const int64 fileSize = audioFile.GetSize();
+    if (fileSize > 0) {
+        // Retrieve all necessary media information. Start with a bounded
+        // probe and only widen it while the decoder fails to recognize it.
         PassString ps(format);
-        if (!mediaInfo_->GetInstantMediaInfo(buf.get(), fileSize, duration,
-                                             bitrate, &ps, NULL, sampleRate,
-                                             channels, NULL)) {
+        int64 prefixSize = initialProbeSize;
+        bool recognized = false;
+        bool truncated = false;
+        for (;;) {
+            vector<int8>* probeBuf = context_->GetProbeBuffer();
+            const size_t probeCapacity = probeBuf->capacity();
+            if (!ReadProbe(audioFile, prefixSize, probeBuf))
+                return false;
+
+            context_->CountGrowth(probeCapacity, probeBuf->capacity());
+
+            const int64 probeSize = static_cast<int64>(probeBuf->size());
+            truncated = probeSize < fileSize;
+            recognized = backend_->GetInstantMediaInfo(
+                &(*probeBuf)[0], probeSize, duration, bitrate, &ps,
+                sampleRate, channels);
+            if (recognized || !truncated)
+                break;
+
+            // Past the cap give up on splicing: an MP4 may keep its moov box
+            // at the end, and its offsets only hold in the unspliced file.
+            prefixSize =
+                (prefixSize >= maxProbeSize) ? fileSize : prefixSize * 2;
+        }
+
+        // Don't let one odd file pin a buffer of its size in the context.
+        vector<int8>* probeBuf = context_->GetProbeBuffer();
+        if (probeBuf->capacity() > maxProbeSize + tailProbeSize)
+            vector<int8>().swap(*probeBuf);
+
+        if (!recognized) {
             // Return true and mark this file as an unrecognized format.
             return true;
         }
@@ -250,29 +495,174 @@ bool AudioQualityIdent::Identify(const wstring& fullPathName, int* sampleRate,
         if (format->empty())
             *format = unknownFormat;
 
-        // Retrieve the average cutoff frequency.
-        scoped_refptr<MySpectrumReceiver> receiver(
-            new MySpectrumReceiver(*sampleRate, cancelFlag_));
+        // A track that ends before the analysis window starts needs no second
+        // open by the spectrum source at all.
+        if (!truncated && (*duration > 0) &&
+            (*duration < analysisOffset * durationUnitsPerSecond))
+            return true;
+
+        vector<int>* sources = context_->GetSources();
+        const size_t sourceCapacity = sources->capacity();
+        GetSpectrumSources(*channels, sources);
+        context_->CountGrowth(sourceCapacity, sources->capacity());
+        IAudioSpectrumReceiver** r = context_->PrepareReceivers(
+            static_cast<int>(sources->size()), *sampleRate);
+
+        // IAudioInformationExtracter can only open files by name, so the
+        // file is opened a second time here.
         if (!spectrumSource_->Open(fullPathName.c_str())) {
             // Return true and mark this file as an unrecognized format.
             return true;
         }
 
+        // The decoder derives the duration and the bitrate from the buffer
+        // length for some formats, so ask the spectrum source once the probe
+        // was partial.
+        if (truncated) {
+            int32 bitsPerSample = 0;
+            int32 channelCount = 0;
+            int32 rate = 0;
+            int64 sampleCount = 0;
+            int32 bitRate = 0;
+            spectrumSource_->ExtractFormat(&bitsPerSample, &channelCount,
+                                           &rate, &sampleCount, &bitRate);
+            if ((rate > 0) && (sampleCount > 0))
+                *duration = sampleCount * durationUnitsPerSecond / rate;
+
+            if (bitRate > 0) {
+                *bitrate = bitRate;
+            } else if (*duration > 0) {
+                *bitrate = static_cast<int>(
+                    fileSize * 8 * durationUnitsPerSecond / *duration);
+            }
+        }
+
+        // In the sampled mode only a few windows spread over the track are
+        // decoded, which caps the cost of very long tracks.
+        const int windowFrames =
+            (options_.WindowFrames + checkPointInterval - 1) /
+                checkPointInterval * checkPointInterval;
+        vector<double>* positions = context_->GetPositions();
+        positions->clear();
+        if (*sampleRate > 0) {
+            const size_t positionCapacity = positions->capacity();
+            GetWindowPositions(
+                static_cast<double>(*duration) / durationUnitsPerSecond,
+                analysisOffset, analysisTail, options_.SampledWindows,
+                GetFramesDuration(*sources, windowFrames, *sampleRate),
+                positions);
+            context_->CountGrowth(positionCapacity, positions->capacity());
+        }
+
+        if (!positions->empty()) {
+            for (auto i = positions->begin(), e = positions->end(); i != e;
+                ++i) {
+                if (!spectrumSource_->Seek(*i))
+                    break;
+
+                context_->StartWindow(windowFrames);
+                ExtractSpectrum(*sources, r, *sampleRate, *channels);
+                if (cancelFlag_ && cancelFlag_->IsSet())
+                    return false;
+
+                if (context_->IsConverged())
+                    break;
+            }
+
+            *cutoff = context_->GetLowestFreq(false);
+            return true;
+        }
+
         // Exclude the first 10 sec data.
-        if (!spectrumSource_->Seek(10.0)) {
+        if (!spectrumSource_->Seek(analysisOffset)) {
             // Return true so that we know it is a short-duration music.
             return true;
         }
 
-        int channel = 0;
-        IAudioSpectrumReceiver* r = receiver.get();
-        spectrumSource_->ExtractSpectrum(&channel, 1, 1024, &r);
+        ExtractSpectrum(*sources, r, *sampleRate, *channels);
         if (cancelFlag_ && cancelFlag_->IsSet())
             return false;
 
-        *cutoff = receiver->GetAverageFreq();
+        *cutoff = context_->GetLowestFreq(true);
+        return true;
+    }
+
+    return false;
+}
+
+int64 AudioQualityIdent::GetGrowthCount() const
+{
+    return context_->GetGrowthCount();
+}
+
+void AudioQualityIdent::GetSpectrumSources(int channels,
+                                           vector<int>* sources) const
+{
+    sources->clear();
+    switch (options_.Channels) {
+        case IdentificationModes::kAllChannels:
+            for (int i = 0; i < min(channels, maxSpectrumSources); ++i)
+                sources->push_back(i);
+
+            break;
+        case IdentificationModes::kMidSide:
+            if (channels >= 2) {
+                sources->push_back(PcmSpectrumEngine::kMid);
+                sources->push_back(PcmSpectrumEngine::kSide);
+            }
+            break;
+        case IdentificationModes::kDownmix:
+            if (channels >= 2)
+                sources->push_back(PcmSpectrumEngine::kDownmix);
+
+            break;
+        default:
+            break;
+    }
+
+    if (sources->empty())
+        sources->push_back(0);
+}
+
+bool AudioQualityIdent::UsesNativeEngine(const vector<int>& sources) const
+{
+    if (!spectrumEngine_)
+        return false;
+
+    if (options_.Engine == IdentificationModes::kNativeSpectrum)
         return true;
+
+    // Only the mixed sources need it, channel indexes stay with the decoder.
+    for (auto i = sources.begin(), e = sources.end(); i != e; ++i) {
+        if (*i < 0)
+            return true;
     }
 
     return false;
+}
+
+void AudioQualityIdent::ExtractSpectrum(const vector<int>& sources,
+                                        IAudioSpectrumReceiver** receivers,
+                                        int sampleRate, int channels)
+{
+    const int count = static_cast<int>(sources.size());
+    if (!UsesNativeEngine(sources)) {
+        spectrumSource_->ExtractSpectrum(&sources[0], count,
+                                         spectrumWindowSize, receivers);
+        return;
+    }
+
+    // Ask for the native format so that the decoder does no resampling and
+    // the bins keep mapping onto |sampleRate|.
+    spectrumEngine_->Start(&sources[0], count, receivers);
+    spectrumSource_->ExtractResampled(16, channels, sampleRate, true,
+                                      spectrumEngine_.get());
+}
+
+double AudioQualityIdent::GetFramesDuration(const vector<int>& sources,
+                                            int frames, int sampleRate) const
+{
+    const int frameAdvance = UsesNativeEngine(sources) ?
+        spectrumEngine_->GetHopSize() : spectrumWindowSize;
+    return static_cast<double>(frames) * frameAdvance / sampleRate;
 }
\ No newline at end of file
@@ -3,18 +3,73 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "cutoff_detector.h"
+#include "decoder_backend.h"
+#include "identification_modes.h"
 #include "third_party/chromium/base/basictypes.h"
 #include "third_party/chromium/base/memory/ref_counted.h"
 #include "third_party/chromium/base/synchronization/cancellation_flag.h"
 
 //------------------------------------------------------------------------------
-struct ICorePlayer;
 struct IAudioInformationExtracter;
+struct IAudioSpectrumReceiver;
+class PcmSpectrumEngine;
 class AudioQualityIdent
 {
 public:
-    explicit AudioQualityIdent(
+    struct Options
+    {
+        Options()
+            : Detector(CutoffDetector::kLogPower)
+            , SampledWindows(0)
+            , WindowFrames(200)
+            , ConvergenceTolerance(0)
+            , ConvergenceCheckPoints(10)
+            , Engine(IdentificationModes::kDecoderSpectrum)
+            , FftSize(1024)
+            , FftOverlap(0)
+            , Backend(DecoderBackend::kMultimediaCore)
+            , DecoderLatency(0)
+            , Channels(IdentificationModes::kFirstChannel)
+        {
+        }
+
+        CutoffDetector::Type Detector;
+
+        // Number of evenly spaced windows to analyze, each |WindowFrames|
+        // spectrum frames long. Zero decodes the whole track.
+        int SampledWindows;
+        int WindowFrames;
+
+        // The extraction stops early once the cutoff estimate has stayed
+        // within |ConvergenceTolerance| Hz for |ConvergenceCheckPoints|
+        // checkpoints. Zero tolerance always decodes to the end.
+        int ConvergenceTolerance;
+        int ConvergenceCheckPoints;
+
+        // |FftSize| must be a power of two from 64 to 16384, others fall back
+        // to 1024. |FftOverlap| is the percentage of every frame shared with
+        // the next one. Both only apply to the native engine, the decoder
+        // always uses 1024 without overlap.
+        IdentificationModes::SpectrumEngine Engine;
+        int FftSize;
+        int FftOverlap;
+
+        // |DecoderLatency| is the synthetic cost, in milliseconds per second
+        // of audio, of the built-in decoder.
+        DecoderBackend::Type Backend;
+        int DecoderLatency;
+
+        // Mid, side and downmix sources only exist on the native engine. A
+        // file they do not apply to, e.g. a mono one, is analyzed on
+        // |Engine| like with kFirstChannel.
+        IdentificationModes::ChannelMode Channels;
+    };
+
+    AudioQualityIdent(
+        const Options& options,
         const std::shared_ptr<base::CancellationFlag>& cancelFlag);
     ~AudioQualityIdent();
 
@@ -23,13 +78,45 @@ public:
                   int* bitrate, int* channels, int* cutoff, int64* duration,
                   std::wstring* format);
 
+    // Growth of the state pooled in the AnalysisContext: receivers created,
+    // and receiver, source, window and probe buffers that had to grow. Stops
+    // increasing once the worker has seen its largest file. This is not a
+    // count of heap allocations; the decoder, the callers of Identify() and
+    // |format| allocate regardless.
+    int64 GetGrowthCount() const;
+
 private:
+    class AnalysisContext;
+
     DISALLOW_COPY_AND_ASSIGN(AudioQualityIdent);
 
-    std::unique_ptr<void, void (__stdcall*)(void*)> funcHost_;
-    scoped_refptr<ICorePlayer> mediaInfo_;
+    // Channel indexes or PcmSpectrumEngine::MixedSource values to analyze.
+    void GetSpectrumSources(int channels, std::vector<int>* sources) const;
+
+    // Whether |sources| are analyzed by |spectrumEngine_| rather than by the
+    // decoder.
+    bool UsesNativeEngine(const std::vector<int>& sources) const;
+
+    // Extracts |sources| from the current position, one receiver each.
+    void ExtractSpectrum(const std::vector<int>& sources,
+                         IAudioSpectrumReceiver** receivers, int sampleRate,
+                         int channels);
+
+    // Seconds of audio covered by |frames| spectrum frames of |sources|.
+    double GetFramesDuration(const std::vector<int>& sources, int frames,
+                             int sampleRate) const;
+
+    std::unique_ptr<DecoderBackend> backend_;
     scoped_refptr<IAudioInformationExtracter> spectrumSource_;
+    Options options_;
     std::shared_ptr<base::CancellationFlag> cancelFlag_;
+
+    // Planned once and reused for every file, NULL unless the native engine
+    // or a mixed channel mode is selected.
+    scoped_refptr<PcmSpectrumEngine> spectrumEngine_;
+
+    // Reused across files, see AnalysisContext.
+    std::unique_ptr<AnalysisContext> context_;
 };
 
 #endif  // _AUDIO_QUALITY_IDENT_H_
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include "batch_mode.h"
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "dir_traversing.h"
+#include "directory_watcher.h"
+#include "parallel_dir_walker.h"
+#include "persistent_map.h"
+#include "scan_session.h"
+#include "third_party/chromium/base/command_line.h"
+#include "third_party/chromium/base/synchronization/cancellation_flag.h"
+#include "third_party/chromium/base/time.h"
+#include "third_party/chromium/base/win/scoped_handle.h"
+
+using std::wstring;
+using std::vector;
+using std::map;
+using std::shared_ptr;
+using std::make_shared;
+using std::wifstream;
+using std::wofstream;
+using std::endl;
+using boost::filesystem::path;
+using boost::filesystem::is_directory;
+using boost::lexical_cast;
+using boost::bad_lexical_cast;
+using base::CancellationFlag;
+using base::TimeTicks;
+using base::TimeDelta;
+
+namespace {
+const char scanSwitch[] = "scan";
+const char mergeSwitch[] = "merge";
+const char resultSwitch[] = "result";
+const char shardSwitch[] = "shard";
+const char watchSwitch[] = "watch";
+const char stopEventSwitch[] = "stop-event";
+
+// Walks the same as DirTraversing, see there.
+const int walkerThreads = 8;
+
+// How long a file has to go without changes before it is taken to be
+// complete. Copies write in bursts, and a writer may close and reopen it.
+const int64 settleSeconds = 2;
+const int pollInterval = 500;
+
+const wchar_t* manifestFileName = L"/manifest.txt";
+const wchar_t* shardKey = L"shard=";
+
+class BatchProgress : public DirTraversing::Callback
+{
+public:
+    BatchProgress() : found_(0) {}
+
+    virtual void Initializing(int totalFiles) {}
+    virtual void TotalChanged(int totalFiles) {}
+    virtual bool Progress(const wstring& current, int64 size,
+                          int64 lastModified)
+    {
+        found_++;
+        return true;
+    }
+    virtual void Done() {}
+
+    int GetFound() const { return found_; }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(BatchProgress);
+
+    int found_;
+};
+
+wstring GetManifestPathName(const wstring& resultDir)
+{
+    return path(resultDir + L"/").remove_filename().wstring() +
+        manifestFileName;
+}
+
+// "<index>/<count>".
+bool ParseShard(const wstring& s, int* index, int* count)
+{
+    const size_t slash = s.find(L'/');
+    if (slash == wstring::npos)
+        return false;
+
+    try {
+        *index = lexical_cast<int>(s.substr(0, slash));
+        *count = lexical_cast<int>(s.substr(slash + 1));
+    } catch (const bad_lexical_cast&) {
+        return false;
+    }
+
+    return (*count > 0) && (*index >= 0) && (*index < *count);
+}
+
+bool GetShardSwitch(const CommandLine& commandLine, int* index, int* count)
+{
+    *index = 0;
+    *count = 1;
+    return !commandLine.HasSwitch(shardSwitch) ||
+        ParseShard(commandLine.GetSwitchValueNative(shardSwitch), index,
+                   count);
+}
+
+bool ReadManifest(const wstring& resultDir, int* index, int* count)
+{
+    wifstream input(GetManifestPathName(resultDir).c_str());
+    wstring line;
+    while (std::getline(input, line)) {
+        if (!line.compare(0, wcslen(shardKey), shardKey))
+            return ParseShard(line.substr(wcslen(shardKey)), index, count);
+    }
+
+    return false;
+}
+
+// Hands every file below |dir| to |session|, which skips those it has already
+// identified. Files still being written are left to the watch if
+// |skipWritten| is set; checking that opens every file.
+bool CatchUp(ScanSession* session, const wstring& dir, bool skipWritten)
+{
+    ParallelDirWalker walker(path(dir).make_preferred().wstring(),
+                             walkerThreads);
+    walker.Start();
+    ParallelDirWalker::Entry entry;
+    while (walker.Next(&entry)) {
+        if (skipWritten &&
+            DirectoryWatcher::IsBeingWritten(entry.FullPathName))
+            continue;
+
+        if (!session->Progress(entry.FullPathName, entry.Size,
+                               entry.LastModified))
+            return false;
+    }
+
+    return true;
+}
+
+// A directory counts only when it has just been created or moved in, its
+// files do not come with changes of their own then.
+bool Submit(ScanSession* session, const wstring& fullPathName, bool added)
+{
+    boost::system::error_code error;
+    if (is_directory(fullPathName, error))
+        return !added || CatchUp(session, fullPathName, true);
+
+    ParallelDirWalker::Entry entry;
+    if (!ParallelDirWalker::GetEntry(fullPathName, &entry))
+        return true;
+
+    return session->Progress(entry.FullPathName, entry.Size,
+                             entry.LastModified);
+}
+
+bool IsSignaled(HANDLE event)
+{
+    return event && (WaitForSingleObject(event, 0) == WAIT_OBJECT_0);
+}
+}
+
+//------------------------------------------------------------------------------
+bool BatchMode::IsRequested(const CommandLine& commandLine)
+{
+    return commandLine.HasSwitch(scanSwitch) ||
+        commandLine.HasSwitch(mergeSwitch) ||
+        commandLine.HasSwitch(watchSwitch);
+}
+
+BatchMode::ExitCode BatchMode::Run(const CommandLine& commandLine)
+{
+    if (commandLine.HasSwitch(resultSwitch) &&
+        commandLine.GetSwitchValueNative(resultSwitch).empty())
+        return kUsage;
+
+    // Failures end up in the exit code, a message box would never be closed.
+    PersistentMapGlobal::GetInstance()->SetInteractive(false);
+    if (commandLine.HasSwitch(scanSwitch))
+        return Scan(commandLine);
+
+    if (commandLine.HasSwitch(watchSwitch))
+        return Watch(commandLine);
+
+    return Merge(commandLine);
+}
+
+BatchMode::ExitCode BatchMode::Scan(const CommandLine& commandLine)
+{
+    const wstring audioDir = commandLine.GetSwitchValueNative(scanSwitch);
+    const wstring resultDir = commandLine.GetSwitchValueNative(resultSwitch);
+    if (audioDir.empty() || resultDir.empty())
+        return kUsage;
+
+    int shardIndex;
+    int shardCount;
+    if (!GetShardSwitch(commandLine, &shardIndex, &shardCount))
+        return kUsage;
+
+    BatchProgress progress;
+    {
+        ScanSession session(&progress, resultDir,
+                            make_shared<CancellationFlag>(), shardIndex,
+                            shardCount);
+        scoped_refptr<DirTraversing> traversing(
+            new DirTraversing(&session, audioDir.c_str()));
+        traversing->Traverse();
+        if (!session.Save())
+            return kFailed;
+    }
+
+    wofstream manifest(GetManifestPathName(resultDir).c_str());
+    manifest << shardKey << shardIndex << L'/' << shardCount << endl;
+    manifest << L"root=" << audioDir << endl;
+    manifest << L"files=" << progress.GetFound() << endl;
+    return manifest.good() ? kSucceeded : kFailed;
+}
+
+BatchMode::ExitCode BatchMode::Merge(const CommandLine& commandLine)
+{
+    const wstring resultDir = commandLine.GetSwitchValueNative(resultSwitch);
+    const CommandLine::StringVector sources = commandLine.GetArgs();
+    if (resultDir.empty() || sources.empty())
+        return kUsage;
+
+    // Read everything first, so that a bad input leaves the target alone.
+    vector<PersistentMap::ContainerType> stores(sources.size());
+    vector<char> covered;
+    bool complete = true;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (!PersistentMap::Load(sources[i], &stores[i]))
+            return kFailed;
+
+        int shardIndex;
+        int shardCount;
+        if (!ReadManifest(sources[i], &shardIndex, &shardCount) ||
+            (!covered.empty() &&
+             (static_cast<int>(covered.size()) != shardCount))) {
+            complete = false;
+            continue;
+        }
+
+        covered.resize(shardCount, 0);
+        covered[shardIndex] = 1;
+    }
+
+    for (size_t i = 0; i < covered.size(); ++i)
+        complete = complete && covered[i];
+
+    shared_ptr<PersistentMap> target =
+        PersistentMap::CreateInstance(resultDir);
+    for (auto i = stores.begin(), e = stores.end(); i != e; ++i)
+        target->Merge(*i);
+
+    if (!target->Save())
+        return kFailed;
+
+    return (complete && !covered.empty()) ? kSucceeded : kShardsMissing;
+}
+
+BatchMode::ExitCode BatchMode::Watch(const CommandLine& commandLine)
+{
+    const wstring audioDir = commandLine.GetSwitchValueNative(watchSwitch);
+    const wstring resultDir = commandLine.GetSwitchValueNative(resultSwitch);
+    if (audioDir.empty() || resultDir.empty())
+        return kUsage;
+
+    int shardIndex;
+    int shardCount;
+    if (!GetShardSwitch(commandLine, &shardIndex, &shardCount))
+        return kUsage;
+
+    // Whoever started the watch ends it by setting the event. It may have
+    // created the event already, or set it before the watch got this far.
+    base::win::ScopedHandle stopEvent;
+    if (commandLine.HasSwitch(stopEventSwitch)) {
+        const wstring name =
+            commandLine.GetSwitchValueNative(stopEventSwitch);
+        if (name.empty())
+            return kUsage;
+
+        stopEvent.Set(CreateEvent(NULL, TRUE, FALSE, name.c_str()));
+        if (!stopEvent.IsValid())
+            return kFailed;
+    }
+
+    // Watching starts before the catch-up walk, so that nothing arriving
+    // meanwhile is missed.
+    DirectoryWatcher watcher(path(audioDir).make_preferred().wstring());
+    if (!watcher.Start())
+        return kFailed;
+
+    BatchProgress progress;
+    ScanSession session(&progress, resultDir, make_shared<CancellationFlag>(),
+                        shardIndex, shardCount);
+    session.Initializing(0);
+
+    // Paths waiting to settle, with the time of their latest change and
+    // whether any of the changes added them.
+    map<wstring, std::pair<TimeTicks, bool>> settling;
+    vector<DirectoryWatcher::Change> changes;
+    bool overflowed = true;
+    bool failed = false;
+    do {
+        // The first round is the catch-up.
+        if (overflowed && !CatchUp(&session, audioDir, false)) {
+            failed = true;
+            break;
+        }
+
+        const TimeTicks now = TimeTicks::Now();
+        for (auto i = changes.begin(), e = changes.end(); i != e; ++i) {
+            auto& entry = settling[i->FullPathName];
+            entry.first = now;
+            entry.second = entry.second || i->Added;
+        }
+
+        bool submitted = true;
+        for (auto i = settling.begin(); submitted && (i != settling.end());) {
+            if (now - i->second.first <
+                TimeDelta::FromSeconds(settleSeconds)) {
+                ++i;
+                continue;
+            }
+
+            if (DirectoryWatcher::IsBeingWritten(i->first)) {
+                i->second.first = now;
+                ++i;
+                continue;
+            }
+
+            submitted = Submit(&session, i->first, i->second.second);
+            settling.erase(i++);
+        }
+
+        if (!submitted) {
+            failed = true;
+            break;
+        }
+
+        changes.clear();
+        failed = !watcher.Wait(pollInterval, &changes, &overflowed);
+    } while (!failed && !IsSignaled(stopEvent.Get()));
+
+    // Commits what is still queued, the rest is in the journal already.
+    // Files still settling are left to the catch-up of the next watch.
+    session.Done();
+    if (!session.Save())
+        return kFailed;
+
+    return failed ? kFailed : kSucceeded;
+}
@@ -0,0 +1,49 @@
+#ifndef _BATCH_MODE_H_
+#define _BATCH_MODE_H_
+
+#include "third_party/chromium/base/basictypes.h"
+
+//------------------------------------------------------------------------------
+// Runs without the dialog, so that several processes, standing in for the
+// nodes that hold parts of an archive, can each scan one shard of it:
+//
+//   --scan=<audio dir> --result=<result dir> [--shard=<index>/<count>]
+//   --merge --result=<result dir> <shard result dir>...
+//   --watch=<audio dir> --result=<result dir> [--shard=<index>/<count>]
+//           [--stop-event=<name>]
+//
+// A scan leaves a manifest next to its store naming the shard. A merge adds
+// every shard store into the store in <result dir>, where the analysis
+// reports pick it up, and checks that the manifests cover every shard.
+//
+// A watch first catches up like a rescan, and then keeps identifying the
+// files that arrive below <audio dir> until the named event is set, which
+// ends it with kSucceeded, or the process is ended. Each result reaches the
+// disk as it is committed, see ResultJournal. A tree that can no longer be
+// watched, or a file that cannot be queued, ends the watch with kFailed.
+class CommandLine;
+class BatchMode
+{
+public:
+    enum ExitCode
+    {
+        kSucceeded = 0,
+        kFailed,
+        kUsage,
+
+        // Merged, but not every shard of the archive was among the inputs.
+        kShardsMissing
+    };
+
+    static bool IsRequested(const CommandLine& commandLine);
+    static ExitCode Run(const CommandLine& commandLine);
+
+private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(BatchMode);
+
+    static ExitCode Scan(const CommandLine& commandLine);
+    static ExitCode Merge(const CommandLine& commandLine);
+    static ExitCode Watch(const CommandLine& commandLine);
+};
+
+#endif  // _BATCH_MODE_H_
@@ -0,0 +1,359 @@
+#include "binary_archive.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#include "mapped_file.h"
+
+using std::wstring;
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::max;
+using std::min;
+
+namespace {
+const char magic[] = "AQIR";
+const uint32 formatVersion = 1;
+const int headerSize = 24;
+const uint32 recordSize = 64;
+
+// The string indexes at the start of a record.
+const int indexesSize = 12;
+
+// Everything but the strings: sample rate, bitrate, channels, cutoff, 0,
+// duration, timestamp, size and last modified.
+const int fieldsSize = 52;
+
+// Read at a time, and buffered before writing.
+const int64 readWindow = 16 * 1024 * 1024;
+const size_t writeBuffer = 1024 * 1024;
+
+uint32 Get32(const uint8* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) |
+        (static_cast<uint32>(p[3]) << 24);
+}
+
+uint64 Get64(const uint8* p)
+{
+    return Get32(p) | (static_cast<uint64>(Get32(p + 4)) << 32);
+}
+
+wstring GetString(const uint8* p, uint32 units)
+{
+    wstring result(units, L'\0');
+    for (uint32 i = 0; i < units; ++i)
+        result[i] = static_cast<wchar_t>(p[i * 2] | (p[i * 2 + 1] << 8));
+
+    return result;
+}
+
+void GetFields(const uint8* p, PersistentMap::MediaInfo* info)
+{
+    info->SampleRate = static_cast<int>(Get32(p));
+    info->Bitrate = static_cast<int>(Get32(p + 4));
+    info->Channels = static_cast<int>(Get32(p + 8));
+    info->CutoffFreq = static_cast<int>(Get32(p + 12));
+    info->Duration = static_cast<int64>(Get64(p + 20));
+    info->Timestamp = static_cast<int64>(Get64(p + 28));
+    info->Size = static_cast<int64>(Get64(p + 36));
+    info->LastModified = static_cast<int64>(Get64(p + 44));
+}
+
+void Put32(uint32 v, vector<char>* buf)
+{
+    buf->push_back(static_cast<char>(v));
+    buf->push_back(static_cast<char>(v >> 8));
+    buf->push_back(static_cast<char>(v >> 16));
+    buf->push_back(static_cast<char>(v >> 24));
+}
+
+void Put64(uint64 v, vector<char>* buf)
+{
+    Put32(static_cast<uint32>(v), buf);
+    Put32(static_cast<uint32>(v >> 32), buf);
+}
+
+void PutString(const wstring& s, vector<char>* buf)
+{
+    Put32(static_cast<uint32>(s.size()), buf);
+    for (auto i = s.begin(), e = s.end(); i != e; ++i) {
+        buf->push_back(static_cast<char>(*i));
+        buf->push_back(static_cast<char>(*i >> 8));
+    }
+}
+
+void PutFields(const PersistentMap::MediaInfo& info, vector<char>* buf)
+{
+    Put32(info.SampleRate, buf);
+    Put32(info.Bitrate, buf);
+    Put32(info.Channels, buf);
+    Put32(info.CutoffFreq, buf);
+    Put32(0, buf);
+    Put64(info.Duration, buf);
+    Put64(info.Timestamp, buf);
+    Put64(info.Size, buf);
+    Put64(info.LastModified, buf);
+}
+
+// Fingerprints are plain ASCII, the table only holds wide strings.
+wstring Widen(const string& s)
+{
+    wstring result(s.size(), L'\0');
+    for (size_t i = 0; i < s.size(); ++i)
+        result[i] = static_cast<unsigned char>(s[i]);
+
+    return result;
+}
+
+string Narrow(const wstring& s)
+{
+    string result(s.size(), '\0');
+    for (size_t i = 0; i < s.size(); ++i)
+        result[i] = static_cast<char>(s[i]);
+
+    return result;
+}
+
+// Walks the file front to back, reading |readWindow| bytes at a time.
+class Reader
+{
+public:
+    explicit Reader(const MappedFile* file)
+        : file_(file)
+        , buf_()
+        , bufOffset_(0)
+        , offset_(0)
+    {
+    }
+
+    // The next |bytes| bytes, or NULL past the end of the file or if they
+    // can not be read. Valid until the next call.
+    const uint8* Take(int64 bytes)
+    {
+        if ((bytes <= 0) || (bytes > file_->GetSize() - offset_))
+            return NULL;
+
+        if (offset_ + bytes > bufOffset_ + static_cast<int64>(buf_.size())) {
+            const int64 length =
+                min(max(bytes, readWindow), file_->GetSize() - offset_);
+            buf_.resize(static_cast<size_t>(length));
+            if (!file_->Read(offset_, length, &buf_[0])) {
+                buf_.clear();
+                return NULL;
+            }
+
+            bufOffset_ = offset_;
+        }
+
+        const uint8* data = &buf_[static_cast<size_t>(offset_ - bufOffset_)];
+        offset_ += bytes;
+        return data;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Reader);
+
+    const MappedFile* file_;
+    vector<uint8> buf_;
+    int64 bufOffset_;
+    int64 offset_;
+};
+
+// Like Reader, over a buffer that holds a single entry.
+class Cursor
+{
+public:
+    Cursor(const char* data, size_t size)
+        : data_(reinterpret_cast<const uint8*>(data))
+        , left_(size)
+    {
+    }
+
+    const uint8* Take(size_t bytes)
+    {
+        if (bytes > left_)
+            return NULL;
+
+        const uint8* data = data_;
+        data_ += bytes;
+        left_ -= bytes;
+        return data;
+    }
+
+    bool TakeString(wstring* s)
+    {
+        const uint8* length = Take(4);
+        if (!length)
+            return false;
+
+        const uint32 units = Get32(length);
+        if (units > left_ / 2)
+            return false;
+
+        *s = GetString(Take(units * 2), units);
+        return true;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Cursor);
+
+    const uint8* data_;
+    size_t left_;
+};
+}
+
+//------------------------------------------------------------------------------
+bool BinaryArchive::Read(const wstring& fullPathName,
+                         PersistentMap::ContainerType* map)
+{
+    MappedFile file;
+    if (!file.Open(fullPathName))
+        return false;
+
+    Reader reader(&file);
+    const uint8* header = reader.Take(headerSize);
+    if (!header || memcmp(header, magic, 4) || !Get32(header + 4))
+        return false;
+
+    const uint32 stringCount = Get32(header + 8);
+    const uint32 recordCount = Get32(header + 12);
+    const uint32 size = Get32(header + 16);
+    if ((size < recordSize) || (stringCount > file.GetSize() / 4))
+        return false;
+
+    vector<wstring> strings(stringCount);
+    for (auto i = strings.begin(), e = strings.end(); i != e; ++i) {
+        const uint8* length = reader.Take(4);
+        if (!length)
+            return false;
+
+        const uint32 units = Get32(length);
+        if (!units)
+            continue;
+
+        const uint8* p = reader.Take(static_cast<int64>(units) * 2);
+        if (!p)
+            return false;
+
+        *i = GetString(p, units);
+    }
+
+    map->clear();
+    for (uint32 i = 0; i < recordCount; ++i) {
+        const uint8* p = reader.Take(size);
+        if (!p || (Get32(p) >= stringCount) ||
+            (Get32(p + 4) >= stringCount) || (Get32(p + 8) >= stringCount))
+            return false;
+
+        PersistentMap::MediaInfo info;
+        info.Format = strings[Get32(p + 4)];
+        info.Fingerprint = Narrow(strings[Get32(p + 8)]);
+        GetFields(p + indexesSize, &info);
+
+        // Sorted, every insertion goes to the end.
+        map->insert(map->end(),
+                    PersistentMap::ContainerType::value_type(
+                        strings[Get32(p)], info));
+    }
+
+    return true;
+}
+
+bool BinaryArchive::Write(const wstring& fullPathName,
+                          const PersistentMap::ContainerType& map)
+{
+    ofstream file(fullPathName.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file.good())
+        return false;
+
+    // The string count is filled in at the end.
+    vector<char> buf;
+    buf.reserve(writeBuffer + 64 * 1024);
+    buf.insert(buf.end(), magic, magic + 4);
+    Put32(formatVersion, &buf);
+    Put32(0, &buf);
+    Put32(static_cast<uint32>(map.size()), &buf);
+    Put32(recordSize, &buf);
+    Put32(0, &buf);
+
+    // Every key is a string of its own, formats and fingerprints are shared.
+    std::map<wstring, uint32> shared;
+    vector<uint32> indexes;
+    indexes.reserve(map.size() * 3);
+    uint32 stringCount = 0;
+    for (auto i = map.begin(), e = map.end(); i != e; ++i) {
+        PutString(i->first, &buf);
+        indexes.push_back(stringCount++);
+
+        const wstring values[] = { i->second.Format,
+                                   Widen(i->second.Fingerprint) };
+        for (size_t j = 0; j < arraysize(values); ++j) {
+            auto inserted = shared.insert(
+                std::make_pair(values[j], stringCount));
+            if (inserted.second) {
+                PutString(values[j], &buf);
+                stringCount++;
+            }
+
+            indexes.push_back(inserted.first->second);
+        }
+
+        if (buf.size() >= writeBuffer) {
+            file.write(&buf[0], buf.size());
+            buf.clear();
+        }
+    }
+
+    auto index = indexes.begin();
+    for (auto i = map.begin(), e = map.end(); i != e; ++i) {
+        Put32(*index++, &buf);
+        Put32(*index++, &buf);
+        Put32(*index++, &buf);
+        PutFields(i->second, &buf);
+        if (buf.size() >= writeBuffer) {
+            file.write(&buf[0], buf.size());
+            buf.clear();
+        }
+    }
+
+    if (!buf.empty())
+        file.write(&buf[0], buf.size());
+
+    buf.clear();
+    Put32(stringCount, &buf);
+    file.seekp(8);
+    file.write(&buf[0], buf.size());
+    file.close();
+    return !file.fail();
+}
+
+void BinaryArchive::PutEntry(const wstring& key,
+                             const PersistentMap::MediaInfo& info,
+                             vector<char>* buf)
+{
+    PutString(key, buf);
+    PutString(info.Format, buf);
+    PutString(Widen(info.Fingerprint), buf);
+    PutFields(info, buf);
+}
+
+bool BinaryArchive::GetEntry(const char* data, size_t size, wstring* key,
+                             PersistentMap::MediaInfo* info)
+{
+    Cursor cursor(data, size);
+    wstring fingerprint;
+    if (!cursor.TakeString(key) || !cursor.TakeString(&info->Format) ||
+        !cursor.TakeString(&fingerprint))
+        return false;
+
+    const uint8* fields = cursor.Take(fieldsSize);
+    if (!fields)
+        return false;
+
+    info->Fingerprint = Narrow(fingerprint);
+    GetFields(fields, info);
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef _BINARY_ARCHIVE_H_
+#define _BINARY_ARCHIVE_H_
+
+#include <string>
+#include <vector>
+
+#include "persistent_map.h"
+
+//------------------------------------------------------------------------------
+// The file format of the result store. Little-endian throughout:
+//
+//   header   "AQIR", version, string count, record count, record size, 0
+//   strings  per string: length in UTF-16 code units, then the code units
+//   records  per entry, sorted by key, |record size| bytes:
+//              key, format and fingerprint as indexes into the strings,
+//              sample rate, bitrate, channels, cutoff, 0 (32 bits each),
+//              duration, timestamp, size, last modified (64 bits each)
+//
+// Formats and fingerprints repeat a lot and are stored once each. Readers
+// skip the tail of records larger than they know, so that later versions can
+// append fields.
+//
+// A single entry can also be written on its own, with its strings inline,
+// which is how the ResultJournal stores them.
+class BinaryArchive
+{
+public:
+    static bool Read(const std::wstring& fullPathName,
+                     PersistentMap::ContainerType* map);
+    static bool Write(const std::wstring& fullPathName,
+                      const PersistentMap::ContainerType& map);
+
+    static void PutEntry(const std::wstring& key,
+                         const PersistentMap::MediaInfo& info,
+                         std::vector<char>* buf);
+    static bool GetEntry(const char* data, size_t size, std::wstring* key,
+                         PersistentMap::MediaInfo* info);
+
+private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(BinaryArchive);
+};
+
+#endif  // _BINARY_ARCHIVE_H_
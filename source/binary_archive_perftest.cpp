@@ -0,0 +1,98 @@
+#include "binary_archive.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include <boost/archive/xml_iarchive.hpp>
+#include <boost/archive/xml_oarchive.hpp>
+
+#include "third_party/chromium/base/scoped_temp_dir.h"
+#include "third_party/chromium/base/time.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::ifstream;
+using std::ofstream;
+using std::wstring;
+
+// The XML archive the store used to be, to compare against. Same fields as
+// version 3 of PersistentMap::MediaInfo in persistent_map.cpp.
+namespace boost
+{
+namespace serialization
+{
+template <typename Archive>
+void serialize(Archive& ar, PersistentMap::MediaInfo& info,
+               const unsigned int version)
+{
+    ar & BOOST_SERIALIZATION_NVP(info.SampleRate);
+    ar & BOOST_SERIALIZATION_NVP(info.Bitrate);
+    ar & BOOST_SERIALIZATION_NVP(info.Channels);
+    ar & BOOST_SERIALIZATION_NVP(info.CutoffFreq);
+    ar & BOOST_SERIALIZATION_NVP(info.Duration);
+    ar & BOOST_SERIALIZATION_NVP(info.Format);
+    ar & BOOST_SERIALIZATION_NVP(info.Timestamp);
+    ar & BOOST_SERIALIZATION_NVP(info.Size);
+    ar & BOOST_SERIALIZATION_NVP(info.LastModified);
+    ar & BOOST_SERIALIZATION_NVP(info.Fingerprint);
+}
+}
+}
+
+BOOST_CLASS_VERSION(PersistentMap::MediaInfo, 3)
+
+// A store of half a million files.
+TEST(BinaryArchivePerfTest, DISABLED_WriteRead)
+{
+    const int entryCount = 500000;
+    PersistentMap::ContainerType map;
+    for (int i = 0; i < entryCount; ++i) {
+        wchar_t key[64];
+        swprintf(key, arraysize(key), L"C:\\music\\artist %d\\track %d.mp3",
+                 i / 12, i);
+        PersistentMap::MediaInfo info(44100, 320, 2, 16000 + i % 5000,
+                                      240000, (i % 2) ? L"MP3" : L"FLAC");
+        info.Size = 8000000 + i;
+        info.LastModified = 130000000000000000LL + i;
+        map[key] = info;
+    }
+
+    ScopedTempDir tempDir;
+    ASSERT_TRUE(tempDir.CreateUniqueTempDir());
+    const wstring fullPathName =
+        tempDir.path().Append(L"results.bin").value();
+
+    base::TimeTicks start = base::TimeTicks::HighResNow();
+    ASSERT_TRUE(BinaryArchive::Write(fullPathName, map));
+    const base::TimeDelta write = base::TimeTicks::HighResNow() - start;
+
+    PersistentMap::ContainerType read;
+    start = base::TimeTicks::HighResNow();
+    ASSERT_TRUE(BinaryArchive::Read(fullPathName, &read));
+    const base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+    EXPECT_EQ(map.size(), read.size());
+
+    const wstring xmlPathName =
+        tempDir.path().Append(L"persistence.xml").value();
+    start = base::TimeTicks::HighResNow();
+    {
+        ofstream outFile(xmlPathName.c_str());
+        boost::archive::xml_oarchive outArch(outFile);
+        outArch << boost::serialization::make_nvp("map_", map);
+    }
+    const base::TimeDelta xmlWrite = base::TimeTicks::HighResNow() - start;
+
+    read.clear();
+    start = base::TimeTicks::HighResNow();
+    {
+        ifstream inFile(xmlPathName.c_str());
+        boost::archive::xml_iarchive inArch(inFile);
+        inArch >> boost::serialization::make_nvp("map_", read);
+    }
+    const base::TimeDelta xmlRead = base::TimeTicks::HighResNow() - start;
+    EXPECT_EQ(map.size(), read.size());
+
+    printf("BinaryArchive write: %.2f ms\n", write.InMillisecondsF());
+    printf("BinaryArchive read:  %.2f ms\n", elapsed.InMillisecondsF());
+    printf("XML archive write:   %.2f ms\n", xmlWrite.InMillisecondsF());
+    printf("XML archive read:    %.2f ms\n", xmlRead.InMillisecondsF());
+}
@@ -0,0 +1,162 @@
+#include "binary_archive.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/scoped_temp_dir.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::ifstream;
+using std::ofstream;
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace {
+void ExpectSameInfo(const PersistentMap::MediaInfo& expected,
+                    const PersistentMap::MediaInfo& actual)
+{
+    EXPECT_EQ(expected.SampleRate, actual.SampleRate);
+    EXPECT_EQ(expected.Bitrate, actual.Bitrate);
+    EXPECT_EQ(expected.Channels, actual.Channels);
+    EXPECT_EQ(expected.CutoffFreq, actual.CutoffFreq);
+    EXPECT_EQ(expected.Duration, actual.Duration);
+    EXPECT_EQ(expected.Format, actual.Format);
+    EXPECT_EQ(expected.Timestamp, actual.Timestamp);
+    EXPECT_EQ(expected.Size, actual.Size);
+    EXPECT_EQ(expected.LastModified, actual.LastModified);
+    EXPECT_EQ(expected.Fingerprint, actual.Fingerprint);
+}
+
+PersistentMap::MediaInfo MakeInfo(int i)
+{
+    const wchar_t* formats[] = {L"MP3", L"FLAC", L"[Unknown]", L""};
+    PersistentMap::MediaInfo info(44100 + i, 320 + i, 1 + i % 8, 16000 + i,
+                                  i * 1000LL, formats[i % 4]);
+    info.Timestamp = 0x123456789abcLL + i;
+    info.Size = (1LL << 40) + i;
+    info.LastModified = -i;
+    if (i % 3)
+        info.Fingerprint = "fingerprint" + string(1, 'a' + i % 3);
+
+    return info;
+}
+
+class BinaryArchiveTest : public testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_TRUE(tempDir_.CreateUniqueTempDir());
+        fullPathName_ = tempDir_.path().Append(L"results.bin").value();
+        for (int i = 0; i < 100; ++i) {
+            wchar_t key[64];
+            swprintf(key, arraysize(key), L"C:\\music\\\x97f3\x4e50 %d.mp3", i);
+            map_[key] = MakeInfo(i);
+        }
+
+        ASSERT_TRUE(BinaryArchive::Write(fullPathName_, map_));
+        ReadBytes(&bytes_);
+    }
+
+    void ReadBytes(string* bytes)
+    {
+        ifstream file(fullPathName_.c_str(), std::ios::binary);
+        bytes->assign(std::istreambuf_iterator<char>(file),
+                      std::istreambuf_iterator<char>());
+    }
+
+    void WriteBytes(const string& bytes)
+    {
+        ofstream file(fullPathName_.c_str(),
+                      std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), bytes.size());
+    }
+
+    ScopedTempDir tempDir_;
+    wstring fullPathName_;
+    PersistentMap::ContainerType map_;
+    string bytes_;
+};
+}
+
+TEST_F(BinaryArchiveTest, RoundTrip)
+{
+    PersistentMap::ContainerType map;
+    ASSERT_TRUE(BinaryArchive::Read(fullPathName_, &map));
+    ASSERT_EQ(map_.size(), map.size());
+    for (auto i = map_.begin(), j = map.begin(); i != map_.end(); ++i, ++j) {
+        EXPECT_EQ(i->first, j->first);
+        ExpectSameInfo(i->second, j->second);
+    }
+}
+
+TEST_F(BinaryArchiveTest, RoundTripEmpty)
+{
+    ASSERT_TRUE(BinaryArchive::Write(fullPathName_,
+                                     PersistentMap::ContainerType()));
+    PersistentMap::ContainerType map(map_);
+    ASSERT_TRUE(BinaryArchive::Read(fullPathName_, &map));
+    EXPECT_TRUE(map.empty());
+}
+
+TEST_F(BinaryArchiveTest, MissingFile)
+{
+    PersistentMap::ContainerType map;
+    EXPECT_FALSE(BinaryArchive::Read(
+        tempDir_.path().Append(L"missing.bin").value(), &map));
+}
+
+TEST_F(BinaryArchiveTest, Truncated)
+{
+    for (size_t size = 0; size < bytes_.size(); size += 7) {
+        WriteBytes(bytes_.substr(0, size));
+        PersistentMap::ContainerType map;
+        EXPECT_FALSE(BinaryArchive::Read(fullPathName_, &map))
+            << size << " bytes";
+    }
+}
+
+TEST_F(BinaryArchiveTest, Corrupt)
+{
+    // Magic, version, an absurd string count, and a record size below the
+    // known one.
+    const size_t offsets[] = {0, 4, 8, 16};
+    const string values[] = {string("AQIX"), string(4, '\0'),
+                             string(4, '\xff'), string("\x3f\0\0\0", 4)};
+    for (size_t i = 0; i < arraysize(offsets); ++i) {
+        string bytes = bytes_;
+        bytes.replace(offsets[i], values[i].size(), values[i]);
+        WriteBytes(bytes);
+        PersistentMap::ContainerType map;
+        EXPECT_FALSE(BinaryArchive::Read(fullPathName_, &map))
+            << "offset " << offsets[i];
+    }
+
+    // A string index of the last record out of range.
+    string bytes = bytes_;
+    bytes.replace(bytes.size() - 64, 4, string(4, '\x7f'));
+    WriteBytes(bytes);
+    PersistentMap::ContainerType map;
+    EXPECT_FALSE(BinaryArchive::Read(fullPathName_, &map));
+}
+
+TEST(BinaryArchiveEntryTest, RoundTrip)
+{
+    const PersistentMap::MediaInfo info = MakeInfo(5);
+    vector<char> buf;
+    BinaryArchive::PutEntry(L"D:\\a\\b.flac", info, &buf);
+
+    wstring key;
+    PersistentMap::MediaInfo read;
+    ASSERT_TRUE(BinaryArchive::GetEntry(&buf[0], buf.size(), &key, &read));
+    EXPECT_EQ(L"D:\\a\\b.flac", key);
+    ExpectSameInfo(info, read);
+
+    for (size_t size = 0; size < buf.size(); ++size) {
+        EXPECT_FALSE(BinaryArchive::GetEntry(&buf[0], size, &key, &read))
+            << size << " bytes";
+    }
+}
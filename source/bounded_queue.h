@@ -0,0 +1,81 @@
+#ifndef _BOUNDED_QUEUE_H_
+#define _BOUNDED_QUEUE_H_
+
+#include <deque>
+
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/base/synchronization/condition_variable.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+
+//------------------------------------------------------------------------------
+// A blocking FIFO shared by producer and consumer threads. Producers are held
+// back once |capacity| items are pending, so a fast producer can never run
+// arbitrarily far ahead of the consumers.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : lock_()
+        , notEmpty_(&lock_)
+        , notFull_(&lock_)
+        , items_()
+        , capacity_(capacity > 0 ? capacity : 1)
+        , closed_(false)
+    {
+    }
+
+    // Blocks while the queue is full. Returns false if the queue has been
+    // closed, in which case the item is dropped.
+    bool Push(const T& item)
+    {
+        base::AutoLock lock(lock_);
+        while (!closed_ && (items_.size() >= capacity_))
+            notFull_.Wait();
+
+        if (closed_)
+            return false;
+
+        items_.push_back(item);
+        notEmpty_.Signal();
+        return true;
+    }
+
+    // Blocks while the queue is empty. Returns false only after the queue is
+    // closed and every pending item has been handed out.
+    bool Pop(T* item)
+    {
+        base::AutoLock lock(lock_);
+        while (!closed_ && items_.empty())
+            notEmpty_.Wait();
+
+        if (items_.empty())
+            return false;
+
+        *item = items_.front();
+        items_.pop_front();
+        notFull_.Signal();
+        return true;
+    }
+
+    // No more items will be accepted. Consumers still drain what is left.
+    void Close()
+    {
+        base::AutoLock lock(lock_);
+        closed_ = true;
+        notEmpty_.Broadcast();
+        notFull_.Broadcast();
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(BoundedQueue);
+
+    base::Lock lock_;
+    base::ConditionVariable notEmpty_;
+    base::ConditionVariable notFull_;
+    std::deque<T> items_;
+    size_t capacity_;
+    bool closed_;
+};
+
+#endif  // _BOUNDED_QUEUE_H_
@@ -0,0 +1,110 @@
+#include "content_fingerprint.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "third_party/chromium/base/file_path.h"
+#include "third_party/chromium/base/md5.h"
+#include "third_party/chromium/base/platform_file.h"
+
+using std::wstring;
+using std::string;
+using std::vector;
+using std::min;
+using boost::lexical_cast;
+
+namespace {
+// Tags sit at either end of a file and the audio in between, eight blocks
+// catch a difference in either.
+const int sampledBlocks = 8;
+const int sampleBlockSize = 16 * 1024;
+const int hashChunkSize = 1024 * 1024;
+
+// Adds |bytes| of the file from |offset| on to |context|.
+bool Update(base::PlatformFile file, int64 offset, int64 bytes,
+            vector<char>* buf, base::MD5Context* context)
+{
+    while (bytes > 0) {
+        const int size = static_cast<int>(
+            min<int64>(bytes, static_cast<int64>(buf->size())));
+        const int read = base::ReadPlatformFile(file, offset, &(*buf)[0],
+                                                size);
+        if (read <= 0)
+            return false;
+
+        base::MD5Update(context, &(*buf)[0], read);
+        offset += read;
+        bytes -= read;
+    }
+
+    return true;
+}
+
+base::PlatformFile Open(const wstring& fullPathName)
+{
+    return base::CreatePlatformFile(
+        FilePath(fullPathName),
+        base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_READ, NULL, NULL);
+}
+}
+
+bool ContentFingerprint::Sample(const wstring& fullPathName, int64 size,
+                                string* fingerprint)
+{
+    base::PlatformFile file = Open(fullPathName);
+    if (file == base::kInvalidPlatformFileValue)
+        return false;
+
+    base::MD5Context context;
+    base::MD5Init(&context);
+    vector<char> buf(sampleBlockSize);
+    bool succeeded = true;
+    if (size <= sampledBlocks * sampleBlockSize) {
+        succeeded = Update(file, 0, size, &buf, &context);
+    } else {
+        for (int i = 0; succeeded && (i < sampledBlocks); ++i) {
+            const int64 offset =
+                (size - sampleBlockSize) * i / (sampledBlocks - 1);
+            succeeded = Update(file, offset, sampleBlockSize, &buf, &context);
+        }
+    }
+
+    base::ClosePlatformFile(file);
+    if (!succeeded)
+        return false;
+
+    base::MD5Digest digest;
+    base::MD5Final(&digest, &context);
+    *fingerprint = lexical_cast<string>(size) + ":" +
+        base::MD5DigestToBase16(digest);
+    return true;
+}
+
+bool ContentFingerprint::Hash(const wstring& fullPathName, string* digest)
+{
+    base::PlatformFile file = Open(fullPathName);
+    if (file == base::kInvalidPlatformFileValue)
+        return false;
+
+    base::MD5Context context;
+    base::MD5Init(&context);
+    vector<char> buf(hashChunkSize);
+    int64 offset = 0;
+    int read;
+    while ((read = base::ReadPlatformFile(file, offset, &buf[0],
+                                          hashChunkSize)) > 0) {
+        base::MD5Update(&context, &buf[0], read);
+        offset += read;
+    }
+
+    base::ClosePlatformFile(file);
+    if (read < 0)
+        return false;
+
+    base::MD5Digest result;
+    base::MD5Final(&result, &context);
+    *digest = base::MD5DigestToBase16(result);
+    return true;
+}
@@ -0,0 +1,27 @@
+#ifndef _CONTENT_FINGERPRINT_H_
+#define _CONTENT_FINGERPRINT_H_
+
+#include <string>
+
+#include "third_party/chromium/base/basictypes.h"
+
+//------------------------------------------------------------------------------
+// Tells byte-identical copies of a track apart from other files without
+// decoding them. The fingerprint is the size plus the MD5 of a few blocks
+// spread evenly over the file, the first and the last among them. Files that
+// share it can be confirmed to be identical by hashing them whole.
+class ContentFingerprint
+{
+public:
+    // Reads at most a few blocks of the file, all of it if it is small.
+    static bool Sample(const std::wstring& fullPathName, int64 size,
+                       std::string* fingerprint);
+
+    // The MD5 of the whole file.
+    static bool Hash(const std::wstring& fullPathName, std::string* digest);
+
+private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ContentFingerprint);
+};
+
+#endif  // _CONTENT_FINGERPRINT_H_
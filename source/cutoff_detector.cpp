@@ -0,0 +1,108 @@
+#include "cutoff_detector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "spectrum_kernel.h"
+
+using std::vector;
+using std::max;
+using std::min;
+
+namespace {
+const float stepDecibels = 3.0f;
+
+// A 3 dB step of 10 * ln(x) is a magnitude ratio of e^0.3, here in Q16.
+const uint64 stepRatioQ16 = 88464;
+
+class LogPowerCutoffDetector : public CutoffDetector
+{
+public:
+    LogPowerCutoffDetector() : power_() {}
+
+    virtual void Reset(int bins)
+    {
+        power_.assign(bins, 0.0f);
+    }
+
+    virtual void Accumulate(const int* magnitudes)
+    {
+        assert(!power_.empty());
+        AccumulatePowerMax(magnitudes, static_cast<int>(power_.size()),
+                           &power_[0]);
+    }
+
+    virtual int FindCutoffIndex() const
+    {
+        const int amount = static_cast<int>(power_.size());
+        float prev = power_[amount - 1];
+        for (int i = amount - 2; i >= 0; --i) {
+            if (fabs(prev - power_[i]) > stepDecibels)
+                return i;
+
+            prev = power_[i];
+        }
+
+        return 0;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(LogPowerCutoffDetector);
+
+    vector<float> power_;
+};
+
+class MagnitudeRatioCutoffDetector : public CutoffDetector
+{
+public:
+    MagnitudeRatioCutoffDetector() : maxima_() {}
+
+    // Magnitudes below 1 count as 1, the same 0 dB floor the log detector
+    // applies.
+    virtual void Reset(int bins)
+    {
+        maxima_.assign(bins, 1);
+    }
+
+    virtual void Accumulate(const int* magnitudes)
+    {
+        assert(!maxima_.empty());
+        const int amount = static_cast<int>(maxima_.size());
+        for (int i = 0; i < amount; ++i)
+            maxima_[i] = max(maxima_[i], magnitudes[i]);
+    }
+
+    virtual int FindCutoffIndex() const
+    {
+        const int amount = static_cast<int>(maxima_.size());
+        uint64 prev = maxima_[amount - 1];
+        for (int i = amount - 2; i >= 0; --i) {
+            const uint64 cur = maxima_[i];
+            if ((max(prev, cur) << 16) > min(prev, cur) * stepRatioQ16)
+                return i;
+
+            prev = cur;
+        }
+
+        return 0;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(MagnitudeRatioCutoffDetector);
+
+    vector<int> maxima_;
+};
+}
+
+CutoffDetector* CutoffDetector::Create(Type type)
+{
+    switch (type) {
+        case kMagnitudeRatio:
+            return new MagnitudeRatioCutoffDetector();
+        case kLogPower:
+        default:
+            return new LogPowerCutoffDetector();
+    }
+}
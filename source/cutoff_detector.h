@@ -0,0 +1,35 @@
+#ifndef _CUTOFF_DETECTOR_H_
+#define _CUTOFF_DETECTOR_H_
+
+#include "third_party/chromium/base/basictypes.h"
+
+//------------------------------------------------------------------------------
+// Collects the per-bin maxima of the spectrum frames within one checkpoint
+// interval and locates the cutoff: scanning down from the highest bin, the
+// first bin whose power differs from its upper neighbour by more than 3 dB.
+class CutoffDetector
+{
+public:
+    enum Type
+    {
+        // Per-bin maxima of 10 * ln(magnitude) in float.
+        kLogPower = 0,
+
+        // Per-bin maxima of the raw magnitudes. The 3 dB step becomes an
+        // integer ratio test, so no transcendental math runs per frame.
+        kMagnitudeRatio
+    };
+
+    static CutoffDetector* Create(Type type);
+
+    virtual ~CutoffDetector() {}
+
+    // Clears the maxima and starts a new interval of |bins| bins.
+    virtual void Reset(int bins) = 0;
+    virtual void Accumulate(const int* magnitudes) = 0;
+
+    // Returns 0 if no step is found.
+    virtual int FindCutoffIndex() const = 0;
+};
+
+#endif  // _CUTOFF_DETECTOR_H_
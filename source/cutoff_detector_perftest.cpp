@@ -0,0 +1,56 @@
+#include "cutoff_detector.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "third_party/chromium/base/time.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+// One minute of 44.1 kHz audio in 1024 point frames, checked every 100
+// frames.
+const int binCount = 512;
+const int frameCount = 2584;
+const int checkpointFrames = 100;
+
+double TimeDetector(CutoffDetector::Type type, const vector<int>& frames)
+{
+    unique_ptr<CutoffDetector> detector(CutoffDetector::Create(type));
+    int cutoffSum = 0;
+    const base::TimeTicks start = base::TimeTicks::HighResNow();
+    detector->Reset(binCount);
+    for (int f = 0; f < frameCount; ++f) {
+        detector->Accumulate(&frames[f * binCount]);
+        if ((f + 1) % checkpointFrames == 0) {
+            cutoffSum += detector->FindCutoffIndex();
+            detector->Reset(binCount);
+        }
+    }
+
+    const base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+    EXPECT_LT(0, cutoffSum);
+    return elapsed.InMillisecondsF();
+}
+}
+
+TEST(CutoffDetectorPerfTest, DISABLED_Accumulate)
+{
+    srand(1);
+    vector<int> frames(binCount * frameCount);
+    for (int f = 0; f < frameCount; ++f) {
+        for (int i = 0; i < binCount; ++i) {
+            const int noise = rand() % 64;
+            frames[f * binCount + i] = (i < 400) ? 20000 + noise * 50 : noise;
+        }
+    }
+
+    const double logPower = TimeDetector(CutoffDetector::kLogPower, frames);
+    const double ratio = TimeDetector(CutoffDetector::kMagnitudeRatio, frames);
+    printf("kLogPower:       %.2f ms\n", logPower);
+    printf("kMagnitudeRatio: %.2f ms (%.1fx)\n", ratio, logPower / ratio);
+}
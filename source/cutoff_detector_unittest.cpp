@@ -0,0 +1,104 @@
+#include "cutoff_detector.h"
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+const int binCount = 512;
+
+class CutoffDetectorTest : public testing::TestWithParam<CutoffDetector::Type>
+{
+protected:
+    virtual void SetUp()
+    {
+        detector_.reset(CutoffDetector::Create(GetParam()));
+    }
+
+    // Feeds one frame of |low| up to and including |cutoff|, |high| above.
+    void AccumulateStep(int cutoff, int low, int high)
+    {
+        vector<int> frame(binCount);
+        for (int i = 0; i < binCount; ++i)
+            frame[i] = (i <= cutoff) ? low : high;
+
+        detector_->Accumulate(&frame[0]);
+    }
+
+    unique_ptr<CutoffDetector> detector_;
+};
+
+TEST_P(CutoffDetectorTest, FindsStep)
+{
+    for (int cutoff = 0; cutoff < binCount - 1; cutoff += 5) {
+        detector_->Reset(binCount);
+        srand(cutoff);
+        for (int f = 0; f < 32; ++f) {
+            vector<int> frame(binCount);
+            for (int i = 0; i < binCount; ++i) {
+                const int noise = rand() % 64;
+                frame[i] = (i <= cutoff) ? 20000 + noise * 50 : noise;
+            }
+
+            detector_->Accumulate(&frame[0]);
+        }
+
+        EXPECT_EQ(cutoff, detector_->FindCutoffIndex());
+    }
+}
+
+TEST_P(CutoffDetectorTest, FlatSpectrumHasNoStep)
+{
+    detector_->Reset(binCount);
+    AccumulateStep(100, 5000, 5000);
+    EXPECT_EQ(0, detector_->FindCutoffIndex());
+}
+
+// e^0.3 is about 1.3499, so 1340 / 1000 stays below 3 dB and 1360 / 1000
+// exceeds it.
+TEST_P(CutoffDetectorTest, StepThreshold)
+{
+    detector_->Reset(binCount);
+    AccumulateStep(200, 1340, 1000);
+    EXPECT_EQ(0, detector_->FindCutoffIndex());
+
+    detector_->Reset(binCount);
+    AccumulateStep(200, 1360, 1000);
+    EXPECT_EQ(200, detector_->FindCutoffIndex());
+
+    detector_->Reset(binCount);
+    AccumulateStep(200, 1000, 1360);
+    EXPECT_EQ(200, detector_->FindCutoffIndex());
+}
+
+TEST_P(CutoffDetectorTest, FloorsAtZeroDecibels)
+{
+    detector_->Reset(binCount);
+    AccumulateStep(300, 1, -20);
+    EXPECT_EQ(0, detector_->FindCutoffIndex());
+
+    AccumulateStep(300, 2, 0);
+    EXPECT_EQ(300, detector_->FindCutoffIndex());
+}
+
+TEST_P(CutoffDetectorTest, KeepsMaximaUntilReset)
+{
+    detector_->Reset(binCount);
+    AccumulateStep(50, 10000, 10);
+    AccumulateStep(400, 10000, 10);
+    EXPECT_EQ(400, detector_->FindCutoffIndex());
+
+    detector_->Reset(binCount);
+    AccumulateStep(50, 10000, 10);
+    EXPECT_EQ(50, detector_->FindCutoffIndex());
+}
+
+INSTANTIATE_TEST_CASE_P(AllTypes, CutoffDetectorTest,
+                        testing::Values(CutoffDetector::kLogPower,
+                                        CutoffDetector::kMagnitudeRatio));
+}
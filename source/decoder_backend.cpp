@@ -0,0 +1,166 @@
+#include "decoder_backend.h"
+
+#include <memory>
+
+#include <boost/filesystem.hpp>
+#include <windows.h>
+
+#include "wave_decoder.h"
+#include "third_party/multimedia_core/player_interface.h"
+#include "third_party/multimedia_core/audio_information_extracter_interface.h"
+
+using std::unique_ptr;
+using std::wstring;
+using boost::filesystem::path;
+
+namespace {
+typedef unique_ptr<void, void (__stdcall*)(void*)> FuncHostType;
+typedef HRESULT (__stdcall* MMCoreFactoryProc)(ICorePlayer** , void*);
+typedef HRESULT (__stdcall* AudioInfoExtrFactoryProc)(
+    IAudioInformationExtracter**);
+
+const int64 durationUnitsPerSecond = 10000000;
+
+bool LoadMultiMediaCoreFunctions(
+    FuncHostType* funcHost, scoped_refptr<ICorePlayer>* mediaInfo,
+    scoped_refptr<IAudioInformationExtracter>* spectrumSource)
+{
+    // We need multimedia core to help accomplish the work.
+    unique_ptr<wchar_t[]> buf(new wchar_t[MAX_PATH]);
+    GetModuleFileName(NULL, buf.get(), MAX_PATH);
+    path p(buf.get());
+    wstring location = p.remove_filename().wstring() + L"/kgplayer.dll";
+    FuncHostType dll(LoadLibrary(location.c_str()),
+                     reinterpret_cast<void (__stdcall*)(void*)>(FreeLibrary));
+    if (!dll)
+        return false;
+
+    // Export all necessary functions.
+    MMCoreFactoryProc mmCoreFactoryProc =
+        reinterpret_cast<MMCoreFactoryProc>(
+            GetProcAddress(reinterpret_cast<HMODULE>(dll.get()),
+                           reinterpret_cast<char*>(3)));
+    if (!mmCoreFactoryProc)
+        return false;
+
+    AudioInfoExtrFactoryProc audioInfoExtrFactoryProc =
+        reinterpret_cast<AudioInfoExtrFactoryProc>(
+            GetProcAddress(reinterpret_cast<HMODULE>(dll.get()),
+                           reinterpret_cast<char*>(7)));
+    if (!audioInfoExtrFactoryProc)
+        return false;
+
+    scoped_refptr<ICorePlayer> interface1;
+    HRESULT r = mmCoreFactoryProc(reinterpret_cast<ICorePlayer**>(&interface1),
+                                  NULL);
+    if (FAILED(r))
+        return false;
+
+    scoped_refptr<IAudioInformationExtracter> interface2;
+    r = audioInfoExtrFactoryProc(
+        reinterpret_cast<IAudioInformationExtracter**>(&interface2));
+    if (FAILED(r))
+        return false;
+
+    funcHost->swap(dll);
+    *mediaInfo = interface1;
+    *spectrumSource = interface2;
+    return true;
+}
+
+class MultimediaCoreBackend : public DecoderBackend
+{
+public:
+    MultimediaCoreBackend()
+        : funcHost_(NULL,
+                    reinterpret_cast<void (__stdcall*)(void*)>(FreeLibrary))
+        , mediaInfo_()
+        , spectrumSource_()
+    {
+    }
+
+    virtual bool Init()
+    {
+        return LoadMultiMediaCoreFunctions(&funcHost_, &mediaInfo_,
+                                           &spectrumSource_);
+    }
+
+    virtual bool GetInstantMediaInfo(const void* buf, int64 length,
+                                     int64* duration, int* bitrate,
+                                     IPassString* format, int* sampleRate,
+                                     int* channels)
+    {
+        return mediaInfo_->GetInstantMediaInfo(buf, length, duration, bitrate,
+                                               format, NULL, sampleRate,
+                                               channels, NULL);
+    }
+
+    virtual scoped_refptr<IAudioInformationExtracter> GetExtracter()
+    {
+        return spectrumSource_;
+    }
+
+private:
+    // Released after the interfaces, which live in the module.
+    FuncHostType funcHost_;
+    scoped_refptr<ICorePlayer> mediaInfo_;
+    scoped_refptr<IAudioInformationExtracter> spectrumSource_;
+};
+
+class BuiltinWaveBackend : public DecoderBackend
+{
+public:
+    explicit BuiltinWaveBackend(int latency)
+        : latency_(latency)
+        , extracter_()
+    {
+    }
+
+    virtual bool Init()
+    {
+        extracter_ = new WaveExtracter(latency_);
+        return true;
+    }
+
+    virtual bool GetInstantMediaInfo(const void* buf, int64 length,
+                                     int64* duration, int* bitrate,
+                                     IPassString* format, int* sampleRate,
+                                     int* channels)
+    {
+        WaveFormat wave;
+        if (!ParseWaveHeader(static_cast<const int8*>(buf), length, &wave))
+            return false;
+
+        // A size left open by a streaming writer is resolved later through
+        // ExtractFormat(), which sees the whole file.
+        const int64 byteRate = static_cast<int64>(wave.SampleRate) *
+            wave.Channels * wave.BitsPerSample / 8;
+        *duration = wave.DataSize * durationUnitsPerSecond / byteRate;
+        *bitrate = static_cast<int>(byteRate * 8);
+        *sampleRate = wave.SampleRate;
+        *channels = wave.Channels;
+        format->SetContent(L"WAV");
+        return true;
+    }
+
+    virtual scoped_refptr<IAudioInformationExtracter> GetExtracter()
+    {
+        return extracter_;
+    }
+
+private:
+    int latency_;
+    scoped_refptr<IAudioInformationExtracter> extracter_;
+};
+}
+
+DecoderBackend* DecoderBackend::Create(Type type, int latency)
+{
+    switch (type) {
+        case kBuiltinWave:
+            return new BuiltinWaveBackend(latency);
+        case kMultimediaCore:
+        default:
+            return new MultimediaCoreBackend();
+    }
+}
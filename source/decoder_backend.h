@@ -0,0 +1,41 @@
+#ifndef _DECODER_BACKEND_H_
+#define _DECODER_BACKEND_H_
+
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/base/memory/ref_counted.h"
+
+//------------------------------------------------------------------------------
+// Everything AudioQualityIdent needs from a decoder: the probe of
+// ICorePlayer::GetInstantMediaInfo() and an IAudioInformationExtracter.
+struct IAudioInformationExtracter;
+struct IPassString;
+class DecoderBackend
+{
+public:
+    enum Type
+    {
+        // kgplayer.dll, loaded next to the executable.
+        kMultimediaCore = 0,
+
+        // Built-in PCM wave decoder, needs no external module.
+        kBuiltinWave
+    };
+
+    // |latency| only applies to kBuiltinWave, see WaveExtracter.
+    static DecoderBackend* Create(Type type, int latency);
+
+    virtual ~DecoderBackend() {}
+
+    virtual bool Init() = 0;
+
+    // Same contract as ICorePlayer::GetInstantMediaInfo().
+    virtual bool GetInstantMediaInfo(const void* buf, int64 length,
+                                     int64* duration, int* bitrate,
+                                     IPassString* format, int* sampleRate,
+                                     int* channels) = 0;
+
+    // Valid once Init() succeeded.
+    virtual scoped_refptr<IAudioInformationExtracter> GetExtracter() = 0;
+};
+
+#endif  // _DECODER_BACKEND_H_
@@ -2,78 +2,44 @@
 
 #include <cassert>
 #include <memory>
-#include <list>
 
 #include <boost/filesystem.hpp>
-#include <boost/algorithm/string.hpp>
 
+#include "parallel_dir_walker.h"
 #include "third_party/chromium/base/message_loop.h"
 
 using std::wstring;
 using std::unique_ptr;
-using std::list;
 using boost::filesystem::path;
 using boost::filesystem::exists;
 using boost::filesystem::is_regular_file;
-using boost::filesystem::directory_iterator;
-using boost::filesystem::is_directory;
-using boost::filesystem::filesystem_error;
-using boost::algorithm::iequals;
 
 namespace {
+// Listing is bound by the latency of the file system rather than by the
+// processors. Several listings in flight hide it, on network shares most of
+// all.
+const int walkerThreads = 8;
+
+// The estimated total is reported again once it has grown by 1/|estimateStep|.
+const int estimateStep = 100;
+
 void ReportDone(DirTraversing::Callback* c)
 {
     if (c)
         c->Done();
 }
 
-int CalculateNumFiles(const path& initialPath)
+// Files found in |listedDirs| directories, extrapolated to the |pendingDirs|
+// still to go.
+int EstimateTotal(int numFiles, int listedDirs, int pendingDirs)
 {
-    if (!exists(initialPath))
-        return 0;
-
-    // Is the specified path a regular file or a directory?
-    if (is_regular_file(initialPath))
-        return 1;
-
-    int fileCount = 0;
-    try {
-        for (directory_iterator i(initialPath), e = directory_iterator();
-            i != e; ++i) {
-            if (is_directory(i->path())) {
-                fileCount += CalculateNumFiles(i->path());
-                continue;
-            }
-
-            fileCount++;
-        }
-    } catch (const filesystem_error&) {
-    }
+    if (!listedDirs)
+        return numFiles;
 
-    return fileCount;
+    return numFiles + static_cast<int>(
+        static_cast<int64>(numFiles) * pendingDirs / listedDirs);
 }
-
-// Return false when Callback::Progress returns false, that is considered as a
-// halt command.
-bool Traverse(const path& cur, list<path>* pending, DirTraversing::Callback* c)
-{
-    try {
-        for (directory_iterator i(cur), e = directory_iterator(); i != e; ++i) {
-            if (is_directory(i->path())) {
-                pending->push_back(i->path());
-                continue;
-            }
-
-            if (!c->Progress(i->path().wstring()))
-                return false;
-        }
-    } catch (const filesystem_error&) {
-    }
-
-    return true;
 }
-}
-
 
 DirTraversing::DirTraversing(Callback* callback,
                              const wchar_t* initialDir)
@@ -88,25 +54,48 @@ void DirTraversing::Traverse()
     assert(callback_);
     unique_ptr<Callback, void (*)(Callback*)> autoReportDone(callback_,
                                                              ReportDone);
-    callback_->Initializing(CalculateNumFiles(initialDir_));
-
-    if (!exists(initialDir_))
+    if (!exists(initialDir_)) {
+        callback_->Initializing(0);
         return;
+    }
 
     if (is_regular_file(initialDir_)) {
-        callback_->Progress(initialDir_);
+        ParallelDirWalker::Entry entry;
+        callback_->Initializing(1);
+        if (ParallelDirWalker::GetEntry(initialDir_, &entry))
+            callback_->Progress(entry.FullPathName, entry.Size,
+                                entry.LastModified);
+
         return;
     }
 
-    list<path> pending;
-    pending.push_back(initialDir_);
-    do {
-        const path& t = pending.front();
-        if (!::Traverse(t, &pending, callback_))
+    // There is no separate counting pass, which would read all the directory
+    // metadata twice. The estimate only grows, so that the progress never
+    // goes backwards, and is only reported once it has grown noticeably.
+    callback_->Initializing(0);
+    ParallelDirWalker walker(path(initialDir_).make_preferred().wstring(),
+                             walkerThreads);
+    walker.Start();
+    ParallelDirWalker::Entry entry;
+    int numFiles = 0;
+    int reported = 0;
+    while (walker.Next(&entry)) {
+        numFiles++;
+        if (!callback_->Progress(entry.FullPathName, entry.Size,
+                                 entry.LastModified))
             return;
 
-        pending.pop_front();
-    } while (pending.size());
+        int listedDirs;
+        int pendingDirs;
+        walker.GetDirCounts(&listedDirs, &pendingDirs);
+        const int estimate = EstimateTotal(numFiles, listedDirs, pendingDirs);
+        if (estimate > reported + reported / estimateStep) {
+            reported = estimate;
+            callback_->TotalChanged(reported);
+        }
+    }
+
+    callback_->TotalChanged(numFiles);
 }
 
 DirTraversing::~DirTraversing()
@@ -14,8 +14,17 @@ public:
     class Callback
     {
     public:
+        // |totalFiles| is only a first estimate, the directory is walked just
+        // once and files are reported as soon as they are found.
         virtual void Initializing(int totalFiles) = 0;
-        virtual bool Progress(const std::wstring& current) = 0;
+
+        // The estimate grows as more directories are discovered, and is exact
+        // with the last call before Done().
+        virtual void TotalChanged(int totalFiles) = 0;
+        // |size| in bytes and |lastModified|, a FILETIME, come with the
+        // directory listing.
+        virtual bool Progress(const std::wstring& current, int64 size,
+                              int64 lastModified) = 0;
 
         // Guaranteed to be called no matter success or failure. After "Done" is
         // called, The TraversingCallback object will no longer be accessed by
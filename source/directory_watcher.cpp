@@ -0,0 +1,145 @@
+#include "directory_watcher.h"
+
+#include <cassert>
+
+#include <windows.h>
+
+using std::wstring;
+using std::vector;
+
+namespace {
+// The most a share on the network accepts for one read of changes.
+const int changeBufferSize = 64 * 1024;
+
+const DWORD notifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME |
+    FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE |
+    FILE_NOTIFY_CHANGE_LAST_WRITE;
+}
+
+//------------------------------------------------------------------------------
+struct DirectoryWatcher::Overlapped
+{
+    OVERLAPPED Value;
+};
+
+DirectoryWatcher::DirectoryWatcher(const wstring& root)
+    : root_(root)
+    , dir_(INVALID_HANDLE_VALUE)
+    , overlapped_(new Overlapped())
+    , buf_(changeBufferSize)
+    , pending_(false)
+{
+    // The changed names are relative and get a separator of their own.
+    while (!root_.empty() && ((*root_.rbegin() == L'\\') ||
+                              (*root_.rbegin() == L'/')))
+        root_.erase(root_.size() - 1);
+
+    memset(&overlapped_->Value, 0, sizeof(overlapped_->Value));
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    if (dir_ == INVALID_HANDLE_VALUE)
+        return;
+
+    // The buffer must stay alive until the system is done with it.
+    DWORD bytes = 0;
+    CancelIo(dir_);
+    if (pending_)
+        GetOverlappedResult(dir_, &overlapped_->Value, &bytes, TRUE);
+
+    CloseHandle(dir_);
+    CloseHandle(overlapped_->Value.hEvent);
+}
+
+bool DirectoryWatcher::Start()
+{
+    assert(dir_ == INVALID_HANDLE_VALUE);
+    HANDLE event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!event)
+        return false;
+
+    dir_ = CreateFile(
+        root_.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+        NULL);
+    if (dir_ == INVALID_HANDLE_VALUE) {
+        CloseHandle(event);
+        return false;
+    }
+
+    overlapped_->Value.hEvent = event;
+    return Issue();
+}
+
+bool DirectoryWatcher::Wait(int timeout, vector<Change>* changes,
+                            bool* overflowed)
+{
+    assert(dir_ != INVALID_HANDLE_VALUE);
+    *overflowed = false;
+    if (!pending_)
+        return false;
+
+    if (WaitForSingleObject(overlapped_->Value.hEvent, timeout) !=
+        WAIT_OBJECT_0)
+        return true;
+
+    DWORD bytes = 0;
+    pending_ = false;
+    if (!GetOverlappedResult(dir_, &overlapped_->Value, &bytes, FALSE)) {
+        if (GetLastError() != ERROR_NOTIFY_ENUM_DIR)
+            return false;
+
+        bytes = 0;
+    }
+
+    // No bytes means the changes did not fit into the buffer.
+    *overflowed = !bytes;
+    for (DWORD offset = 0; bytes;) {
+        const FILE_NOTIFY_INFORMATION* info =
+            reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(&buf_[offset]);
+        if ((info->Action != FILE_ACTION_REMOVED) &&
+            (info->Action != FILE_ACTION_RENAMED_OLD_NAME)) {
+            Change change;
+            change.FullPathName = root_ + L"\\" +
+                wstring(info->FileName,
+                        info->FileNameLength / sizeof(info->FileName[0]));
+            change.Added = info->Action != FILE_ACTION_MODIFIED;
+            changes->push_back(change);
+        }
+
+        if (!info->NextEntryOffset)
+            break;
+
+        offset += info->NextEntryOffset;
+    }
+
+    return Issue();
+}
+
+bool DirectoryWatcher::IsBeingWritten(const wstring& fullPathName)
+{
+    // Sharing only the reads fails as long as anybody else may write.
+    HANDLE file = CreateFile(fullPathName.c_str(), GENERIC_READ,
+                             FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return GetLastError() == ERROR_SHARING_VIOLATION;
+
+    CloseHandle(file);
+    return false;
+}
+
+bool DirectoryWatcher::Issue()
+{
+    HANDLE event = overlapped_->Value.hEvent;
+    memset(&overlapped_->Value, 0, sizeof(overlapped_->Value));
+    overlapped_->Value.hEvent = event;
+    ResetEvent(event);
+    pending_ = !!ReadDirectoryChangesW(dir_, &buf_[0],
+                                       static_cast<DWORD>(buf_.size()), TRUE,
+                                       notifyFilter, NULL,
+                                       &overlapped_->Value, NULL);
+    return pending_;
+}
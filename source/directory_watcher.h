@@ -0,0 +1,62 @@
+#ifndef _DIRECTORY_WATCHER_H_
+#define _DIRECTORY_WATCHER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/basictypes.h"
+
+//------------------------------------------------------------------------------
+// Reports the paths created, renamed into, or written below a directory tree
+// through ReadDirectoryChangesW(). Unlike base::files::FilePathWatcher it
+// watches the whole subtree and names the changed entries, and it needs no
+// message loop. Removals are not reported.
+//
+// Windows sends no notice when a file is closed, IsBeingWritten() tells
+// whether a writer still holds it open.
+class DirectoryWatcher
+{
+public:
+    struct Change
+    {
+        std::wstring FullPathName;
+
+        // Created or renamed into the tree, rather than written to. Only
+        // these matter for directories, which also change whenever an entry
+        // is added to them.
+        bool Added;
+    };
+
+    explicit DirectoryWatcher(const std::wstring& root);
+    ~DirectoryWatcher();
+
+    bool Start();
+
+    // Waits up to |timeout| milliseconds and appends the changes to
+    // |changes|, possibly several for one path. |overflowed| is set when
+    // changes were lost and the caller has to walk the tree to catch up.
+    // Returns false once the tree can no longer be watched, e.g. because it
+    // has been removed.
+    bool Wait(int timeout, std::vector<Change>* changes, bool* overflowed);
+
+    // Whether another handle has |fullPathName| open for writing.
+    static bool IsBeingWritten(const std::wstring& fullPathName);
+
+private:
+    struct Overlapped;
+
+    DISALLOW_COPY_AND_ASSIGN(DirectoryWatcher);
+
+    bool Issue();
+
+    std::wstring root_;
+    void* dir_;
+    std::unique_ptr<Overlapped> overlapped_;
+    std::vector<char> buf_;
+
+    // A read of changes is outstanding and owns |buf_|.
+    bool pending_;
+};
+
+#endif  // _DIRECTORY_WATCHER_H_
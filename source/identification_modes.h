@@ -0,0 +1,54 @@
+#ifndef _IDENTIFICATION_MODES_H_
+#define _IDENTIFICATION_MODES_H_
+
+#include "third_party/chromium/base/basictypes.h"
+
+//------------------------------------------------------------------------------
+// The modes the Preference stores for AudioQualityIdent and the
+// IdentificationPipeline. They live apart from those classes, so that reading
+// the settings does not pull in the decoders.
+class IdentificationModes
+{
+public:
+    enum SpectrumEngine
+    {
+        // IAudioInformationExtracter::ExtractSpectrum().
+        kDecoderSpectrum = 0,
+
+        // Our own FFT over the PCM from ExtractResampled().
+        kNativeSpectrum
+    };
+
+    enum ChannelMode
+    {
+        kFirstChannel = 0,
+
+        // Every channel in the same decoding pass, the lowest cutoff wins.
+        kAllChannels,
+
+        // Mid and side of the first two channels, the lowest cutoff wins.
+        // Joint stereo encoders often band-limit the side only.
+        kMidSide,
+
+        // A single downmix of all channels, one FFT per frame.
+        kDownmix
+    };
+
+    // See ContentFingerprint.
+    enum Deduplication
+    {
+        // Every file is identified on its own.
+        kNoDeduplication = 0,
+
+        // Files with the same fingerprint share one result.
+        kSampledContent,
+
+        // As above, once the whole files have been found identical.
+        kConfirmedContent
+    };
+
+private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(IdentificationModes);
+};
+
+#endif  // _IDENTIFICATION_MODES_H_
@@ -0,0 +1,496 @@
+#include "identification_pipeline.h"
+
+#include <cassert>
+#include <map>
+
+#include "content_fingerprint.h"
+#include "prefetcher.h"
+#include "worker_process.h"
+#include "third_party/chromium/base/sys_info.h"
+#include "third_party/chromium/base/threading/simple_thread.h"
+
+using std::wstring;
+using std::string;
+using std::vector;
+using std::map;
+using std::shared_ptr;
+using std::unique_ptr;
+using base::CancellationFlag;
+using base::DelegateSimpleThread;
+
+namespace {
+// Number of pending files per worker. Large enough to hide the traversal
+// latency and to give the scheduler a choice of big files to start with,
+// small enough to keep the traversal from running far ahead.
+const int queueDepthPerWorker = 16;
+
+int ResolveWorkerCount(int numWorkers)
+{
+    return numWorkers > 0 ? numWorkers : base::SysInfo::NumberOfProcessors();
+}
+
+// Neither a crash nor an unrecognized format says anything about the
+// content, so such a result is not handed to its copies.
+bool IsShareable(const PersistentMap::MediaInfo& info)
+{
+    return !info.Format.empty() && (L"[Unknown]" != info.Format) &&
+        (L"[Crash]" != info.Format);
+}
+}
+
+//------------------------------------------------------------------------------
+// Results by ContentFingerprint. The first file of some content is decoded,
+// its copies take over the result, or wait for it while it is being decoded.
+// Entries are never removed. The copies of a file whose result is not
+// shareable, see IsShareable(), are decoded each on their own.
+class IdentificationPipeline::ContentTable
+{
+public:
+    enum Outcome
+    {
+        // The caller decodes the file and reports back through Complete().
+        kIdentify,
+
+        // The result of the same content is known.
+        kKnown,
+
+        // The same content could not be identified before.
+        kUnsupported,
+
+        // Another worker is decoding the same content, and picks the job up
+        // in its Complete().
+        kAttached
+    };
+
+    explicit ContentTable(bool confirm)
+        : confirm_(confirm)
+        , lock_()
+        , contents_()
+    {
+    }
+
+    // Not synchronized, only for use before the workers start.
+    void Seed(const PersistentMap::ContainerType& store)
+    {
+        for (auto i = store.begin(), e = store.end(); i != e; ++i) {
+            const PersistentMap::MediaInfo& info = i->second;
+            if (info.Fingerprint.empty() || !IsShareable(info))
+                continue;
+
+            Content& content = contents_[i->second.Fingerprint];
+            content.Owner = i->first;
+            content.Done = true;
+            content.Supported = true;
+            content.Info = i->second;
+        }
+    }
+
+    // Looks |job| up by its fingerprint, and fills |info| if the result is
+    // known. The fingerprint is cleared if the file cannot be confirmed, the
+    // caller decodes it then, outside of the table.
+    Outcome Claim(Job* job, PersistentMap::MediaInfo* info)
+    {
+        Content* content;
+        string ownerDigest;
+        {
+            base::AutoLock lock(lock_);
+            auto existing = contents_.find(job->Fingerprint);
+            if (!confirm_ || (existing == contents_.end()) ||
+                (existing->second.Owner == job->FullPathName))
+                return Enter(job, info);
+
+            content = &existing->second;
+            ownerDigest = content->Digest;
+        }
+
+        // Without the lock, the files may be large. |Owner| never changes.
+        string digest;
+        if (!ContentFingerprint::Hash(job->FullPathName, &digest)) {
+            job->Fingerprint.clear();
+            return kIdentify;
+        }
+
+        const bool ownerHashed = !ownerDigest.empty() ||
+            ContentFingerprint::Hash(content->Owner, &ownerDigest);
+
+        base::AutoLock lock(lock_);
+        if (ownerHashed)
+            content->Digest = ownerDigest;
+
+        if (ownerHashed && (digest == ownerDigest))
+            return Join(content, job, info);
+
+        // Sampled alike, but not the same content. The whole digest tells
+        // it apart.
+        job->Fingerprint += "/" + digest;
+        return Enter(job, info);
+    }
+
+    // The owner of some content is done, |info| is NULL if the file could
+    // not be identified. A result that is not shareable is not taken for the
+    // content. Hands back the jobs that waited for it.
+    void Complete(const Job& job, const PersistentMap::MediaInfo* info,
+                  vector<Job>* attached)
+    {
+        base::AutoLock lock(lock_);
+        Content& content = contents_[job.Fingerprint];
+        content.Done = true;
+        content.Inconclusive = info && !IsShareable(*info);
+        content.Supported = info && !content.Inconclusive;
+        if (content.Supported)
+            content.Info = *info;
+
+        attached->clear();
+        attached->swap(content.Attached);
+    }
+
+private:
+    struct Content
+    {
+        Content()
+            : Owner()
+            , Digest()
+            , Done(false)
+            , Supported(false)
+            , Inconclusive(false)
+            , Info()
+            , Attached()
+        {
+        }
+
+        // The file that is or was decoded, and its whole MD5 once needed.
+        wstring Owner;
+        string Digest;
+        bool Done;
+        bool Supported;
+        bool Inconclusive;
+        PersistentMap::MediaInfo Info;
+        vector<Job> Attached;
+    };
+
+    DISALLOW_COPY_AND_ASSIGN(ContentTable);
+
+    // Called with |lock_| held. Makes the caller the owner of new content.
+    Outcome Enter(Job* job, PersistentMap::MediaInfo* info)
+    {
+        auto existing = contents_.find(job->Fingerprint);
+        if (existing == contents_.end()) {
+            contents_[job->Fingerprint].Owner = job->FullPathName;
+            return kIdentify;
+        }
+
+        return Join(&existing->second, job, info);
+    }
+
+    // Called with |lock_| held.
+    Outcome Join(Content* content, Job* job, PersistentMap::MediaInfo* info)
+    {
+        if (!content->Done) {
+            content->Attached.push_back(*job);
+            return kAttached;
+        }
+
+        if (content->Inconclusive) {
+            job->Fingerprint.clear();
+            return kIdentify;
+        }
+
+        if (!content->Supported)
+            return kUnsupported;
+
+        *info = content->Info;
+        return kKnown;
+    }
+
+    bool confirm_;
+    base::Lock lock_;
+    map<string, Content> contents_;
+};
+
+//------------------------------------------------------------------------------
+class IdentificationPipeline::Worker : public DelegateSimpleThread::Delegate
+{
+public:
+    Worker(int lane, WorkStealingQueue<Job>* jobs,
+           BoundedQueue<Result>* results, Prefetcher* prefetcher,
+           ContentTable* contents,
+           const AudioQualityIdent::Options& options,
+           const shared_ptr<CancellationFlag>& cancelFlag,
+           int isolationTimeout)
+        : lane_(lane)
+        , jobs_(jobs)
+        , results_(results)
+        , prefetcher_(prefetcher)
+        , contents_(contents)
+        , cancelFlag_(cancelFlag)
+        , ident_(options, cancelFlag)
+        , process_(isolationTimeout > 0 ?
+                       new WorkerProcess(options, isolationTimeout,
+                                         cancelFlag) :
+                       NULL)
+        , format_()
+        , thread_()
+    {
+    }
+
+    // The decoders are only loaded in the child of an isolated worker.
+    bool Init() { return process_ ? process_->Start() : ident_.Init(); }
+
+    // Only valid once the thread has been joined.
+    int64 GetGrowthCount() const { return ident_.GetGrowthCount(); }
+
+    void Start()
+    {
+        thread_.reset(new DelegateSimpleThread(this, "Identification Worker"));
+        thread_->Start();
+    }
+
+    void Join()
+    {
+        if (thread_)
+            thread_->Join();
+    }
+
+    virtual void Run()
+    {
+        Job job;
+        vector<Job> attached;
+        while (jobs_->Pop(lane_, &job)) {
+            // Keep draining after cancellation so that the producer is never
+            // left blocked on a full queue.
+            if (prefetcher_)
+                prefetcher_->Release(job.FullPathName);
+
+            if (cancelFlag_ && cancelFlag_->IsSet())
+                continue;
+
+            Result result;
+            result.Key = job.Key;
+            if (contents_ &&
+                ContentFingerprint::Sample(job.FullPathName, job.Size,
+                                           &job.Fingerprint)) {
+                const ContentTable::Outcome outcome =
+                    contents_->Claim(&job, &result.Info);
+                if (outcome == ContentTable::kKnown)
+                    Push(job, &result);
+
+                if (outcome != ContentTable::kIdentify)
+                    continue;
+            }
+
+            const bool identified = Identify(job.FullPathName, &result.Info);
+            if (identified)
+                Push(job, &result);
+
+            if (job.Fingerprint.empty())
+                continue;
+
+            // The copies that turned up while this one was decoded. Unless
+            // its result is shareable, each of them is decoded on its own.
+            contents_->Complete(job, identified ? &result.Info : NULL,
+                                &attached);
+            const bool shared = identified && IsShareable(result.Info);
+            for (auto i = attached.begin(), e = attached.end(); i != e; ++i) {
+                if (cancelFlag_ && cancelFlag_->IsSet())
+                    break;
+
+                Result copy;
+                copy.Key = i->Key;
+                copy.Info = result.Info;
+                if (shared || Identify(i->FullPathName, &copy.Info))
+                    Push(*i, &copy);
+            }
+        }
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+
+    // Returns false if the file is not supported, or the scan has been
+    // cancelled meanwhile.
+    bool Identify(const wstring& fullPathName, PersistentMap::MediaInfo* info)
+    {
+        if (process_)
+            return process_->Identify(fullPathName, info);
+
+        try {
+            int sampleRate;
+            int bitrate;
+            int channels;
+            int cutoff;
+            int64 duration;
+            if (!ident_.Identify(fullPathName, &sampleRate, &bitrate,
+                                 &channels, &cutoff, &duration, &format_))
+                return false;
+
+            *info = PersistentMap::MediaInfo(sampleRate, bitrate, channels,
+                                             cutoff, duration, format_);
+        } catch (const std::exception&) {
+            *info = PersistentMap::MediaInfo(0, 0, 0, 0, 0,
+                                             wstring(L"[Crash]"));
+        }
+
+        return true;
+    }
+
+    void Push(const Job& job, Result* result)
+    {
+        // What the next scan compares against.
+        result->Info.Size = job.Size;
+        result->Info.LastModified = job.LastModified;
+        result->Info.Fingerprint = job.Fingerprint;
+        results_->Push(*result);
+    }
+
+    int lane_;
+    WorkStealingQueue<Job>* jobs_;
+    BoundedQueue<Result>* results_;
+    Prefetcher* prefetcher_;
+    ContentTable* contents_;
+    shared_ptr<CancellationFlag> cancelFlag_;
+    AudioQualityIdent ident_;
+    unique_ptr<WorkerProcess> process_;
+
+    // Keeps its capacity across files.
+    wstring format_;
+    unique_ptr<DelegateSimpleThread> thread_;
+};
+
+//------------------------------------------------------------------------------
+class IdentificationPipeline::Sink : public DelegateSimpleThread::Delegate
+{
+public:
+    Sink(BoundedQueue<Result>* results, PersistentMap* store)
+        : results_(results)
+        , store_(store)
+        , thread_(this, "Identification Sink")
+    {
+    }
+
+    void Start() { thread_.Start(); }
+    void Join() { thread_.Join(); }
+
+    virtual void Run()
+    {
+        Result result;
+        while (results_->Pop(&result))
+            store_->Commit(result.Key, result.Info);
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Sink);
+
+    BoundedQueue<Result>* results_;
+    PersistentMap* store_;
+    DelegateSimpleThread thread_;
+};
+
+//------------------------------------------------------------------------------
+IdentificationPipeline::IdentificationPipeline(
+    const shared_ptr<PersistentMap>& store,
+    const AudioQualityIdent::Options& options,
+    const shared_ptr<CancellationFlag>& cancelFlag, int numWorkers,
+    int64 prefetchBudget, int isolationTimeout,
+    IdentificationModes::Deduplication deduplication)
+    : store_(store)
+    , cancelFlag_(cancelFlag)
+    , jobs_(ResolveWorkerCount(numWorkers),
+            ResolveWorkerCount(numWorkers) * queueDepthPerWorker)
+    , results_(ResolveWorkerCount(numWorkers) * queueDepthPerWorker)
+    , workers_()
+    , sink_()
+    , prefetcher_(prefetchBudget > 0 ? new Prefetcher(prefetchBudget) : NULL)
+    , contents_(deduplication != IdentificationModes::kNoDeduplication ?
+                    new ContentTable(
+                        deduplication ==
+                            IdentificationModes::kConfirmedContent) :
+                    NULL)
+    , started_(false)
+{
+    assert(store_);
+    const int workerCount = ResolveWorkerCount(numWorkers);
+    for (int i = 0; i < workerCount; ++i)
+        workers_.push_back(
+            shared_ptr<Worker>(
+                new Worker(i, &jobs_, &results_, prefetcher_.get(),
+                           contents_.get(), options, cancelFlag_,
+                           isolationTimeout)));
+}
+
+IdentificationPipeline::~IdentificationPipeline()
+{
+    Finish();
+}
+
+bool IdentificationPipeline::Start()
+{
+    assert(!started_);
+    if (started_ || !store_)
+        return false;
+
+    for (auto i = workers_.begin(), e = workers_.end(); i != e; ++i)
+        if (!(*i)->Init())
+            return false;
+
+    // Copies of tracks identified in earlier scans are not decoded again.
+    if (contents_)
+        contents_->Seed(store_->GetMap());
+
+    sink_.reset(new Sink(&results_, store_.get()));
+    sink_->Start();
+    if (prefetcher_)
+        prefetcher_->Start();
+
+    for (auto i = workers_.begin(), e = workers_.end(); i != e; ++i)
+        (*i)->Start();
+
+    started_ = true;
+    return true;
+}
+
+bool IdentificationPipeline::Submit(const wstring& key,
+                                    const wstring& fullPathName, int64 size,
+                                    int64 lastModified)
+{
+    if (!started_)
+        return false;
+
+    Job job;
+    job.Key = key;
+    job.FullPathName = fullPathName;
+    job.Size = size;
+    job.LastModified = lastModified;
+
+    // Give the prefetcher a head start while Push() may still block.
+    if (prefetcher_)
+        prefetcher_->Add(fullPathName, size);
+
+    return jobs_.Push(job, size);
+}
+
+void IdentificationPipeline::Finish()
+{
+    if (!started_)
+        return;
+
+    jobs_.Close();
+    for (auto i = workers_.begin(), e = workers_.end(); i != e; ++i)
+        (*i)->Join();
+
+    if (prefetcher_)
+        prefetcher_->Stop();
+
+    results_.Close();
+    sink_->Join();
+    started_ = false;
+}
+
+int64 IdentificationPipeline::GetGrowthCount() const
+{
+    assert(!started_);
+    int64 count = 0;
+    for (auto i = workers_.begin(), e = workers_.end(); i != e; ++i)
+        count += (*i)->GetGrowthCount();
+
+    return count;
+}
@@ -0,0 +1,93 @@
+#ifndef _IDENTIFICATION_PIPELINE_H_
+#define _IDENTIFICATION_PIPELINE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_quality_ident.h"
+#include "bounded_queue.h"
+#include "identification_modes.h"
+#include "persistent_map.h"
+#include "work_stealing_queue.h"
+#include "third_party/chromium/base/synchronization/cancellation_flag.h"
+
+//------------------------------------------------------------------------------
+// Fans the files found by the traversal out to a pool of worker threads. Every
+// worker owns a private AudioQualityIdent, so the decoder instances are never
+// shared. A single sink thread commits the results into the PersistentMap.
+// The file size serves as the cost estimate of the WorkStealingQueue, so that
+// long tracks are started first. A Prefetcher reads the queued files ahead
+// of the workers unless |prefetchBudget| is zero. Unless |isolationTimeout|
+// is zero, every worker hands its files to a WorkerProcess, which gives up on
+// a file after |isolationTimeout| seconds.
+//
+// With |deduplication| on, a worker fingerprints each file before decoding
+// it. A file whose content is already known, from the store or from earlier
+// in the scan, takes over that result. A file whose content another worker
+// is decoding right now waits in the ContentTable and gets the same result,
+// or is decoded on its own should that one fail or crash.
+class Prefetcher;
+class IdentificationPipeline
+{
+public:
+    IdentificationPipeline(
+        const std::shared_ptr<PersistentMap>& store,
+        const AudioQualityIdent::Options& options,
+        const std::shared_ptr<base::CancellationFlag>& cancelFlag,
+        int numWorkers, int64 prefetchBudget, int isolationTimeout,
+        IdentificationModes::Deduplication deduplication);
+    ~IdentificationPipeline();
+
+    // Loads the decoders for every worker and starts all threads.
+    bool Start();
+
+    // Queues a file of |size| bytes for identification. Blocks while the
+    // queue is full. |size| and |lastModified| are stored with the result.
+    bool Submit(const std::wstring& key, const std::wstring& fullPathName,
+                int64 size, int64 lastModified);
+
+    // Returns after every submitted file has been committed.
+    void Finish();
+
+    // Sum of AudioQualityIdent::GetGrowthCount() over all workers. Only
+    // valid after Finish(). Isolated workers analyze in their children, for
+    // them the sum stays zero.
+    int64 GetGrowthCount() const;
+
+private:
+    class Worker;
+    class Sink;
+    class ContentTable;
+
+    struct Job
+    {
+        std::wstring Key;
+        std::wstring FullPathName;
+        int64 Size;
+        int64 LastModified;
+
+        // Set by the worker, see ContentFingerprint.
+        std::string Fingerprint;
+    };
+
+    struct Result
+    {
+        std::wstring Key;
+        PersistentMap::MediaInfo Info;
+    };
+
+    DISALLOW_COPY_AND_ASSIGN(IdentificationPipeline);
+
+    std::shared_ptr<PersistentMap> store_;
+    std::shared_ptr<base::CancellationFlag> cancelFlag_;
+    WorkStealingQueue<Job> jobs_;
+    BoundedQueue<Result> results_;
+    std::vector<std::shared_ptr<Worker>> workers_;
+    std::unique_ptr<Sink> sink_;
+    std::unique_ptr<Prefetcher> prefetcher_;
+    std::unique_ptr<ContentTable> contents_;
+    bool started_;
+};
+
+#endif  // _IDENTIFICATION_PIPELINE_H_
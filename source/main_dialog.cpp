@@ -12,9 +12,8 @@
 #include "my_app.h"
 #include "preference.h"
 #include "progress_dialog.h"
-#include "audio_quality_ident.h"
 #include "persistent_map.h"
-#include "third_party/chromium/base/synchronization/cancellation_flag.h"
+#include "scan_session.h"
 
 using std::wstring;
 using std::unique_ptr;
@@ -24,7 +23,6 @@ using std::endl;
 using boost::algorithm::trim_right;
 using boost::filesystem::path;
 using boost::lexical_cast;
-using base::CancellationFlag;
 
 namespace {
 int __stdcall BrowseCallbackProc(HWND winHandle, UINT message, LPARAM param,
@@ -273,7 +271,7 @@ void CreateFakeHighQualityReport(const PersistentMap::ContainerType& result,
         if (info.CutoffFreq > minCutoff)
             continue;
 
-        wstring v1 = i->first;
+        wstring v1 = path(i->first).filename().wstring();
         wstring v2 = lexical_cast<wstring>(info.Bitrate / 1000);
         wstring v3 = lexical_cast<wstring>(info.CutoffFreq / 1000.0);
         wstring v4 = lexical_cast<wstring>(info.Duration / 10000000.0);
@@ -506,86 +504,6 @@ void CreateSampleRateProportionReport(
         output << proportion << endl;
     }
 }
-
-class Intermedia : public DirTraversing::Callback
-{
-public:
-    Intermedia(DirTraversing::Callback* callback, const wstring& resultDir,
-               const shared_ptr<CancellationFlag>& cancelFlag)
-        : callback_(callback)
-        , ident_(cancelFlag)
-        , initialized_(false)
-        , persResult_()
-        , resultDir_(resultDir)
-    {
-    }
-    ~Intermedia() {}
-
-    virtual void Initializing(int totalFiles)
-    {
-        if (initialized_)
-            return;
-
-        callback_->Initializing(totalFiles);
-        persResult_ = PersistentMap::CreateInstance(resultDir_);
-        initialized_ = ident_.Init();
-    }
-
-    virtual bool Progress(const std::wstring& current)
-    {
-        if (!initialized_)
-            return false;
-
-        bool rv = callback_->Progress(current);
-        if (!rv)
-            return rv;
-
-        PersistentMap::ContainerType& persistentMap = persResult_->GetMap();
-        wstring fileName(path(current).filename().wstring());
-        auto iter = persistentMap.find(fileName);
-        if (iter != persistentMap.end())
-            return rv;
-
-        int sampleRate;
-        int bitrate;
-        int channels;
-        int cutoff;
-        int64 duration;
-        wstring format;
-        try {
-            if (ident_.Identify(current, &sampleRate, &bitrate, &channels,
-                                &cutoff, &duration, &format))
-                persistentMap.insert(
-                    PersistentMap::ContainerType::value_type(
-                        fileName,
-                        PersistentMap::MediaInfo(sampleRate, bitrate, channels,
-                                                 cutoff, duration, format)));
-        } catch (const std::exception&) {
-            persistentMap.insert(
-                PersistentMap::ContainerType::value_type(
-                    fileName,
-                    PersistentMap::MediaInfo(0, 0, 0, 0, 0,
-                                             wstring(L"[Crash]"))));
-            return rv;
-        }
-
-        return rv;
-    }
-
-    virtual void Done()
-    {
-        callback_->Done();
-    }
-
-private:
-    DISALLOW_COPY_AND_ASSIGN(Intermedia);
-
-    DirTraversing::Callback* callback_;
-    AudioQualityIdent ident_;
-    bool initialized_;
-    shared_ptr<PersistentMap> persResult_;
-    wstring resultDir_;
-};
 }
 
 MainDialog::MainDialog(CWnd* parent)
@@ -782,8 +700,8 @@ void MainDialog::OnBnClickedButtonStart()
         resultDir_.AddString(text);
 
     ProgressDialog d(this);
-    Intermedia inte(&d, resultDir, d.GetCancellationFlag());
-    dirTraversing_.Traverse(&inte, audioDir.c_str());
+    ScanSession session(&d, resultDir, d.GetCancellationFlag(), 0, 1);
+    dirTraversing_.Traverse(&session, audioDir.c_str());
     d.DoModal();
 }
 
@@ -0,0 +1,173 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <windows.h>
+
+using std::wstring;
+
+namespace {
+// Mapped at a time by Read(), which keeps large reads within the address
+// space of the process.
+const int64 readWindow = 16 * 1024 * 1024;
+
+int64 GetAllocationGranularity()
+{
+    SYSTEM_INFO info = {0};
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+}
+
+// Views have to start at a multiple of it. Resolved during static
+// initialization, before any worker thread exists.
+const int64 allocationGranularity = GetAllocationGranularity();
+
+// Kept apart from anything with a destructor, which __try does not allow.
+bool CopyFromView(void* dest, const void* src, size_t size)
+{
+    __try {
+        memcpy(dest, src, size);
+    } __except ((GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR) ?
+                EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+        return false;
+    }
+
+    return true;
+}
+}
+
+//------------------------------------------------------------------------------
+MappedFile::View::View()
+    : base_(NULL)
+    , data_(NULL)
+    , size_(0)
+{
+}
+
+MappedFile::View::~View()
+{
+    Reset();
+}
+
+void MappedFile::View::Reset()
+{
+    if (base_)
+        UnmapViewOfFile(base_);
+
+    base_ = NULL;
+    data_ = NULL;
+    size_ = 0;
+}
+
+//------------------------------------------------------------------------------
+MappedFile::MappedFile()
+    : file_(base::kInvalidPlatformFileValue)
+    , mapping_(NULL)
+    , size_(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const wstring& fullPathName)
+{
+    Close();
+
+    // The same as base::CreatePlatformFile() with PLATFORM_FILE_OPEN and
+    // PLATFORM_FILE_READ, without a FilePath copy of the name for every file.
+    file_ = CreateFile(fullPathName.c_str(), GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_ == base::kInvalidPlatformFileValue)
+        return false;
+
+    base::PlatformFileInfo info;
+    if (!base::GetPlatformFileInfo(file_, &info) || info.is_directory) {
+        Close();
+        return false;
+    }
+
+    size_ = info.size;
+
+    // An empty file can not be mapped, but it is still a valid file.
+    if (size_ > 0) {
+        mapping_ = CreateFileMapping(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping_) {
+            Close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mapping_)
+        CloseHandle(mapping_);
+
+    if (file_ != base::kInvalidPlatformFileValue)
+        base::ClosePlatformFile(file_);
+
+    file_ = base::kInvalidPlatformFileValue;
+    mapping_ = NULL;
+    size_ = 0;
+}
+
+bool MappedFile::IsValid() const
+{
+    return file_ != base::kInvalidPlatformFileValue;
+}
+
+bool MappedFile::Map(int64 offset, int64 length, View* view) const
+{
+    assert(view);
+    view->Reset();
+    if (!mapping_ || (offset < 0) || (offset >= size_) || (length <= 0))
+        return false;
+
+    if (length > size_ - offset)
+        length = size_ - offset;
+
+    const int64 alignedOffset = offset - offset % allocationGranularity;
+    const int64 viewLength = length + (offset - alignedOffset);
+    if (viewLength > static_cast<int64>(static_cast<SIZE_T>(-1)))
+        return false;
+
+    void* base = MapViewOfFile(mapping_, FILE_MAP_READ,
+                               static_cast<DWORD>(alignedOffset >> 32),
+                               static_cast<DWORD>(alignedOffset),
+                               static_cast<SIZE_T>(viewLength));
+    if (!base)
+        return false;
+
+    view->base_ = base;
+    view->data_ = static_cast<const int8*>(base) + (offset - alignedOffset);
+    view->size_ = length;
+    return true;
+}
+
+bool MappedFile::Read(int64 offset, int64 length, void* dest) const
+{
+    if ((offset < 0) || (length < 0) || (length > size_ - offset))
+        return false;
+
+    int8* out = static_cast<int8*>(dest);
+    View view;
+    while (length > 0) {
+        if (!Map(offset, std::min(length, readWindow), &view) ||
+            !CopyFromView(out, view.GetData(),
+                          static_cast<size_t>(view.GetSize())))
+            return false;
+
+        out += view.GetSize();
+        offset += view.GetSize();
+        length -= view.GetSize();
+    }
+
+    return true;
+}
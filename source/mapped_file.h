@@ -0,0 +1,67 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <string>
+
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/base/platform_file.h"
+
+//------------------------------------------------------------------------------
+// Read-only, memory-mapped access to a file of any size. Only the windows that
+// are asked for get mapped, so files larger than the address space of the
+// process can still be inspected.
+//
+// Touching the data of a View raises EXCEPTION_IN_PAGE_ERROR if the page can
+// not be read in, e.g. because the file was truncated while mapped or a
+// network share went away, and that ends the process. Anything that reads a
+// file which may change underneath it should go through Read() instead.
+class MappedFile
+{
+public:
+    class View
+    {
+    public:
+        View();
+        ~View();
+
+        const int8* GetData() const { return data_; }
+        int64 GetSize() const { return size_; }
+
+        void Reset();
+
+    private:
+        friend class MappedFile;
+
+        DISALLOW_COPY_AND_ASSIGN(View);
+
+        void* base_;
+        const int8* data_;
+        int64 size_;
+    };
+
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const std::wstring& fullPathName);
+    void Close();
+
+    bool IsValid() const;
+    int64 GetSize() const { return size_; }
+
+    // Maps [offset, offset + length) into |view|. The range is clamped to the
+    // end of the file.
+    bool Map(int64 offset, int64 length, View* view) const;
+
+    // Copies [offset, offset + length) to |dest|. Fails if the range is not
+    // within the file or the pages can not be read in.
+    bool Read(int64 offset, int64 length, void* dest) const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(MappedFile);
+
+    base::PlatformFile file_;
+    void* mapping_;
+    int64 size_;
+};
+
+#endif  // _MAPPED_FILE_H_
@@ -8,9 +8,12 @@
 #include <boost/filesystem.hpp>
 #include <dbghelp.h>
 
+#include "batch_mode.h"
 #include "main_dialog.h"
 #include "persistent_map.h"
+#include "worker_process.h"
 #include "third_party/chromium/base/at_exit.h"
+#include "third_party/chromium/base/command_line.h"
 
 using std::wstringstream;
 using std::wstring;
@@ -66,6 +69,7 @@ LONG __stdcall MyUnhandledExceptionFilter(EXCEPTION_POINTERS* exceptionInfo)
 AudioQualityIdentificationApp theApp;
 
 AudioQualityIdentificationApp::AudioQualityIdentificationApp()
+    : exitCode_(-1)
 {
     m_dwRestartManagerSupportFlags = AFX_RESTART_MANAGER_SUPPORT_RESTART;
 }
@@ -76,7 +80,20 @@ BOOL AudioQualityIdentificationApp::InitInstance()
     atExit = new base::AtExitManager;
 
     SetErrorMode(SEM_NOGPFAULTERRORBOX);
+
+    // A worker process simply dies on a crash, its parent records the file.
+    CommandLine::Init(0, NULL);
+    const CommandLine* commandLine = CommandLine::ForCurrentProcess();
+    if (commandLine->HasSwitch(WorkerProcess::identifyWorkerSwitch)) {
+        exitCode_ = WorkerProcess::RunChild(*commandLine);
+        return FALSE;
+    }
+
     SetUnhandledExceptionFilter(MyUnhandledExceptionFilter);
+    if (BatchMode::IsRequested(*commandLine)) {
+        exitCode_ = BatchMode::Run(*commandLine);
+        return FALSE;
+    }
 
     // InitCommonControlsEx() is required on Windows XP if an application
     // manifest specifies use of ComCtl32.dll version 6 or later to enable
@@ -110,6 +127,8 @@ BOOL AudioQualityIdentificationApp::InitInstance()
 int AudioQualityIdentificationApp::ExitInstance()
 {
     int result = CWinApp::ExitInstance();
+    if (exitCode_ >= 0)
+        result = exitCode_;
 
     assert(atExit);
     if (atExit) {
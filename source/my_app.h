@@ -14,6 +14,10 @@ public:
     virtual int ExitInstance();
 
     DECLARE_MESSAGE_MAP()
+
+private:
+    // Set by the modes that run without the dialog, -1 otherwise.
+    int exitCode_;
 };
 
 extern AudioQualityIdentificationApp theApp;
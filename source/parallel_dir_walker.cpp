@@ -0,0 +1,183 @@
+#include "parallel_dir_walker.h"
+
+#include <cassert>
+
+#include <windows.h>
+
+using std::wstring;
+using std::vector;
+using base::AutoLock;
+
+namespace {
+// Files found but not yet picked up. Keeps the listing well ahead of the
+// consumer without holding the names of a whole archive.
+const int fileQueueCapacity = 4096;
+
+bool IsDotOrDotDot(const wchar_t* name)
+{
+    return (name[0] == L'.') &&
+        (!name[1] || ((name[1] == L'.') && !name[2]));
+}
+
+int64 ToInt64(DWORD high, DWORD low)
+{
+    return (static_cast<int64>(high) << 32) | low;
+}
+
+HANDLE FindFirst(const wstring& pattern, WIN32_FIND_DATA* data)
+{
+    // Skips the short names and fetches in larger batches. Both flags are
+    // only known since Windows 7.
+    HANDLE find = FindFirstFileEx(pattern.c_str(), FindExInfoBasic, data,
+                                  FindExSearchNameMatch, NULL,
+                                  FIND_FIRST_EX_LARGE_FETCH);
+    if ((find == INVALID_HANDLE_VALUE) &&
+        (GetLastError() == ERROR_INVALID_PARAMETER))
+        find = FindFirstFileEx(pattern.c_str(), FindExInfoStandard, data,
+                               FindExSearchNameMatch, NULL, 0);
+
+    return find;
+}
+}
+
+ParallelDirWalker::ParallelDirWalker(const wstring& root, int numThreads)
+    : numThreads_(numThreads > 0 ? numThreads : 1)
+    , lock_()
+    , frontierChanged_(&lock_)
+    , frontier_(1, root)
+    , busy_(0)
+    , listed_(0)
+    , stopped_(false)
+    , files_(fileQueueCapacity)
+    , threads_("Directory Walker", numThreads > 0 ? numThreads : 1)
+    , started_(false)
+{
+    // Every listed path gets its own separator.
+    wstring& dir = frontier_.back();
+    while (!dir.empty() && ((*dir.rbegin() == L'\\') ||
+                            (*dir.rbegin() == L'/')))
+        dir.erase(dir.size() - 1);
+}
+
+ParallelDirWalker::~ParallelDirWalker()
+{
+    {
+        AutoLock lock(lock_);
+        stopped_ = true;
+        frontierChanged_.Broadcast();
+    }
+
+    files_.Close();
+    if (started_)
+        threads_.JoinAll();
+}
+
+void ParallelDirWalker::Start()
+{
+    assert(!started_);
+    threads_.AddWork(this, numThreads_);
+    threads_.Start();
+    started_ = true;
+}
+
+bool ParallelDirWalker::GetEntry(const wstring& fullPathName, Entry* entry)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(fullPathName.c_str(), GetFileExInfoStandard,
+                             &data))
+        return false;
+
+    entry->FullPathName = fullPathName;
+    entry->Size = ToInt64(data.nFileSizeHigh, data.nFileSizeLow);
+    entry->LastModified = ToInt64(data.ftLastWriteTime.dwHighDateTime,
+                                  data.ftLastWriteTime.dwLowDateTime);
+    return true;
+}
+
+bool ParallelDirWalker::Next(Entry* entry)
+{
+    return files_.Pop(entry);
+}
+
+void ParallelDirWalker::GetDirCounts(int* listed, int* pending)
+{
+    AutoLock lock(lock_);
+    *listed = listed_;
+    *pending = static_cast<int>(frontier_.size()) + busy_;
+}
+
+void ParallelDirWalker::Run()
+{
+    wstring dir;
+    for (;;) {
+        {
+            AutoLock lock(lock_);
+            while (!stopped_ && frontier_.empty() && busy_)
+                frontierChanged_.Wait();
+
+            if (stopped_)
+                return;
+
+            if (frontier_.empty()) {
+                // Nobody is listing anything that could add to the frontier.
+                frontierChanged_.Broadcast();
+                break;
+            }
+
+            // The most recently found directory first, which keeps the
+            // frontier small.
+            dir.swap(frontier_.back());
+            frontier_.pop_back();
+            busy_++;
+        }
+
+        const bool completed = List(dir);
+
+        AutoLock lock(lock_);
+        busy_--;
+        listed_++;
+        frontierChanged_.Broadcast();
+        if (!completed)
+            return;
+    }
+
+    files_.Close();
+}
+
+bool ParallelDirWalker::List(const wstring& dir)
+{
+    WIN32_FIND_DATA data;
+    HANDLE find = FindFirst(dir + L"\\*", &data);
+    if (find == INVALID_HANDLE_VALUE)
+        return true;
+
+    vector<wstring> subdirs;
+    bool completed = true;
+    do {
+        if (IsDotOrDotDot(data.cFileName))
+            continue;
+
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            subdirs.push_back(dir + L"\\" + data.cFileName);
+            continue;
+        }
+
+        Entry entry;
+        entry.FullPathName = dir + L"\\" + data.cFileName;
+        entry.Size = ToInt64(data.nFileSizeHigh, data.nFileSizeLow);
+        entry.LastModified = ToInt64(data.ftLastWriteTime.dwHighDateTime,
+                                     data.ftLastWriteTime.dwLowDateTime);
+        if (!files_.Push(entry)) {
+            completed = false;
+            break;
+        }
+    } while (FindNextFile(find, &data));
+
+    FindClose(find);
+    if (!subdirs.empty()) {
+        AutoLock lock(lock_);
+        frontier_.insert(frontier_.end(), subdirs.begin(), subdirs.end());
+    }
+
+    return completed;
+}
@@ -0,0 +1,69 @@
+#ifndef _PARALLEL_DIR_WALKER_H_
+#define _PARALLEL_DIR_WALKER_H_
+
+#include <string>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/base/synchronization/condition_variable.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/threading/simple_thread.h"
+
+//------------------------------------------------------------------------------
+// Lists a directory tree with |numThreads| threads that pull directories off a
+// shared frontier and push the subdirectories they find back onto it. Every
+// directory is read with FindFirstFileEx(), whose entries already carry the
+// attributes and the size, so no file is opened or queried on its own. The
+// files found are handed to a single consumer in no particular order.
+class ParallelDirWalker : public base::DelegateSimpleThread::Delegate
+{
+public:
+    struct Entry
+    {
+        std::wstring FullPathName;
+        int64 Size;
+
+        // FILETIME of the last write.
+        int64 LastModified;
+    };
+
+    // Fills |entry| for a single file outside of a walk.
+    static bool GetEntry(const std::wstring& fullPathName, Entry* entry);
+
+    ParallelDirWalker(const std::wstring& root, int numThreads);
+    virtual ~ParallelDirWalker();
+
+    void Start();
+
+    // Blocks until the next file has been found. Returns false once the
+    // whole tree has been listed.
+    bool Next(Entry* entry);
+
+    // Directories listed so far, and directories found but not yet listed.
+    void GetDirCounts(int* listed, int* pending);
+
+    virtual void Run();
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ParallelDirWalker);
+
+    // Returns false once the walker is being destroyed.
+    bool List(const std::wstring& dir);
+
+    int numThreads_;
+    base::Lock lock_;
+    base::ConditionVariable frontierChanged_;
+    std::vector<std::wstring> frontier_;
+
+    // Threads listing a directory. The walk is over once none is and the
+    // frontier is empty.
+    int busy_;
+    int listed_;
+    bool stopped_;
+    BoundedQueue<Entry> files_;
+    base::DelegateSimpleThreadPool threads_;
+    bool started_;
+};
+
+#endif  // _PARALLEL_DIR_WALKER_H_
@@ -0,0 +1,115 @@
+#include "parallel_dir_walker.h"
+
+#include <map>
+#include <string>
+
+#include "third_party/chromium/base/file_util.h"
+#include "third_party/chromium/base/scoped_temp_dir.h"
+#include "third_party/chromium/base/string_number_conversions.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::map;
+using std::string;
+using std::wstring;
+
+namespace {
+// Three levels of directories, each holding a few files and two more
+// directories, with one empty directory on the side.
+class ParallelDirWalkerTest : public testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_TRUE(tempDir_.CreateUniqueTempDir());
+        ASSERT_TRUE(file_util::CreateDirectory(
+            tempDir_.path().Append(L"empty")));
+        CreateTree(tempDir_.path(), 3);
+    }
+
+    void CreateTree(const FilePath& dir, int depth)
+    {
+        for (int i = 0; i < 3; ++i) {
+            const FilePath file =
+                dir.Append(L"file " + base::IntToString16(i) + L".mp3");
+            const string content(sizes_.size(), 'x');
+            ASSERT_EQ(static_cast<int>(content.size()),
+                      file_util::WriteFile(file, content.data(),
+                                           static_cast<int>(content.size())));
+            sizes_[file.value()] = static_cast<int64>(content.size());
+        }
+
+        if (!depth)
+            return;
+
+        for (int i = 0; i < 2; ++i) {
+            const FilePath subdir = dir.Append(L"dir " +
+                                               base::IntToString16(i));
+            ASSERT_TRUE(file_util::CreateDirectory(subdir));
+            CreateTree(subdir, depth - 1);
+        }
+    }
+
+    void ExpectWalk(int numThreads)
+    {
+        map<wstring, int64> sizes(sizes_);
+        ParallelDirWalker walker(tempDir_.path().value(), numThreads);
+        walker.Start();
+        ParallelDirWalker::Entry entry;
+        while (walker.Next(&entry)) {
+            auto i = sizes.find(entry.FullPathName);
+            ASSERT_TRUE(i != sizes.end()) << entry.FullPathName;
+            EXPECT_EQ(i->second, entry.Size);
+            EXPECT_NE(0, entry.LastModified);
+            sizes.erase(i);
+        }
+
+        EXPECT_TRUE(sizes.empty());
+
+        int listed;
+        int pending;
+        walker.GetDirCounts(&listed, &pending);
+        EXPECT_EQ(1 + 1 + 2 + 4 + 8, listed);
+        EXPECT_EQ(0, pending);
+    }
+
+    ScopedTempDir tempDir_;
+    map<wstring, int64> sizes_;
+};
+}
+
+TEST_F(ParallelDirWalkerTest, FindsEveryFileOnce)
+{
+    ExpectWalk(1);
+}
+
+TEST_F(ParallelDirWalkerTest, FindsEveryFileOnceInParallel)
+{
+    ExpectWalk(4);
+}
+
+TEST_F(ParallelDirWalkerTest, EmptyDirectory)
+{
+    ParallelDirWalker walker(tempDir_.path().Append(L"empty").value(), 4);
+    walker.Start();
+    ParallelDirWalker::Entry entry;
+    EXPECT_FALSE(walker.Next(&entry));
+}
+
+TEST_F(ParallelDirWalkerTest, StopsWhenDestroyedEarly)
+{
+    ParallelDirWalker walker(tempDir_.path().value(), 4);
+    walker.Start();
+    ParallelDirWalker::Entry entry;
+    EXPECT_TRUE(walker.Next(&entry));
+}
+
+TEST_F(ParallelDirWalkerTest, GetEntry)
+{
+    const wstring fullPathName = sizes_.rbegin()->first;
+    ParallelDirWalker::Entry entry;
+    ASSERT_TRUE(ParallelDirWalker::GetEntry(fullPathName, &entry));
+    EXPECT_EQ(fullPathName, entry.FullPathName);
+    EXPECT_EQ(sizes_.rbegin()->second, entry.Size);
+    EXPECT_FALSE(ParallelDirWalker::GetEntry(
+        tempDir_.path().Append(L"missing.mp3").value(), &entry));
+}
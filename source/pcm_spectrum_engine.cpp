@@ -0,0 +1,162 @@
+#include "pcm_spectrum_engine.h"
+
+#include <algorithm>
+#include <cassert>
+
+using std::vector;
+using std::min;
+
+namespace {
+// Magnitudes of full scale 16-bit input stay far below this even for the
+// largest frames, it only guards against garbage input.
+const float maxMagnitude = 2147483520.0f;
+
+float MixSource(const int16* frame, int channels, int source)
+{
+    switch (source) {
+        case PcmSpectrumEngine::kMid:
+            return 0.5f * (frame[0] + frame[1]);
+        case PcmSpectrumEngine::kSide:
+            return 0.5f * (frame[0] - frame[1]);
+        case PcmSpectrumEngine::kDownmix: {
+            float sum = 0.0f;
+            for (int c = 0; c < channels; ++c)
+                sum += frame[c];
+
+            return sum / channels;
+        }
+        default:
+            return frame[source];
+    }
+}
+}
+
+//------------------------------------------------------------------------------
+class PcmSpectrumEngine::Spectrum : public kugou::CUnknown, public IAudioSpectrum
+{
+public:
+    Spectrum(int* frequencies, int count)
+        : kugou::CUnknown(NULL, NULL)
+        , frequencies_(frequencies)
+        , count_(count)
+    {
+    }
+
+    DELEGATE_IUNKNOWN;
+    virtual void __stdcall Init(int32 frequencies)
+    {
+        // The block is owned by the engine and already sized.
+        assert(frequencies == count_);
+    }
+    virtual int __stdcall GetFrequenciesCount() const { return count_; }
+    virtual int* __stdcall GetFrequencies() const { return frequencies_; }
+
+private:
+    int* frequencies_;
+    int count_;
+};
+
+//------------------------------------------------------------------------------
+PcmSpectrumEngine::PcmSpectrumEngine(int fftSize, int overlapPercent)
+    : kugou::CUnknown(NULL, NULL)
+    , fft_(fftSize)
+    , hop_(std::max(
+          1, fftSize * (100 - std::max(0, min(overlapPercent, 99))) / 100))
+    , sources_()
+    , receivers_()
+    , active_()
+    , pending_()
+    , pendingFrames_(0)
+    , magnitudes_(fft_.GetBinCount())
+    , frequencies_()
+    , spectra_()
+{
+}
+
+PcmSpectrumEngine::~PcmSpectrumEngine()
+{
+}
+
+int PcmSpectrumEngine::GetBlockAlign(int sampleRate) const
+{
+    return hop_;
+}
+
+bool PcmSpectrumEngine::Receive(IAudioSample* samples)
+{
+    assert(!sources_.empty());
+    if (sources_.empty() || !samples || (samples->GetBitsPerSample() != 16))
+        return false;
+
+    const int channels = samples->GetChannels();
+    const int sourceCount = static_cast<int>(sources_.size());
+    for (int s = 0; s < sourceCount; ++s) {
+        const int source = sources_[s];
+        if ((source >= channels) || (source < kDownmix) ||
+            (((source == kMid) || (source == kSide)) && (channels < 2)))
+            return false;
+    }
+
+    const int16* pcm = static_cast<const int16*>(samples->GetSamples());
+    const int count = samples->GetSampleCount();
+    const int size = fft_.GetSize();
+    for (int i = 0; i < count; ++i) {
+        const int16* frame = pcm + i * channels;
+        for (int s = 0; s < sourceCount; ++s)
+            pending_[s * size + pendingFrames_] =
+                MixSource(frame, channels, sources_[s]);
+
+        if (++pendingFrames_ >= size)
+            if (!AnalyzePending())
+                return false;
+    }
+
+    return true;
+}
+
+void PcmSpectrumEngine::Start(const int* sources, int count,
+                              IAudioSpectrumReceiver** receivers)
+{
+    assert(sources && receivers && (count > 0));
+    sources_.assign(sources, sources + count);
+    receivers_.assign(receivers, receivers + count);
+    active_.assign(count, 1);
+    pending_.resize(count * fft_.GetSize());
+    pendingFrames_ = 0;
+
+    const int bins = fft_.GetBinCount();
+    if (static_cast<int>(spectra_.size()) != count) {
+        frequencies_.resize(count * bins);
+        spectra_.clear();
+        for (int s = 0; s < count; ++s)
+            spectra_.push_back(new Spectrum(&frequencies_[s * bins], bins));
+    }
+}
+
+bool PcmSpectrumEngine::AnalyzePending()
+{
+    const int size = fft_.GetSize();
+    const int bins = fft_.GetBinCount();
+    const int sourceCount = static_cast<int>(sources_.size());
+    bool more = false;
+    for (int s = 0; s < sourceCount; ++s) {
+        float* plane = &pending_[s * size];
+        if (active_[s]) {
+            fft_.ComputeMagnitudes(plane, &magnitudes_[0]);
+            int* frequencies = spectra_[s]->GetFrequencies();
+            for (int i = 0; i < bins; ++i)
+                frequencies[i] =
+                    static_cast<int>(min(magnitudes_[i], maxMagnitude));
+
+            if (receivers_[s]->Receive(spectra_[s].get()))
+                more = true;
+            else
+                active_[s] = 0;
+        }
+
+        std::copy(plane + hop_, plane + size, plane);
+    }
+
+    pendingFrames_ -= hop_;
+    return more;
+}
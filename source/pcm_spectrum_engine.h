@@ -0,0 +1,73 @@
+#ifndef _PCM_SPECTRUM_ENGINE_H_
+#define _PCM_SPECTRUM_ENGINE_H_
+
+#include <vector>
+
+#include "real_fft.h"
+#include "third_party/chromium/base/memory/ref_counted.h"
+#include "third_party/multimedia_core/audio_sample_extracter_interface.h"
+#include "third_party/multimedia_core/audio_spectrum_extracter_interface.h"
+#include "third_party/multimedia_core/common/unknown_impl.h"
+
+//------------------------------------------------------------------------------
+// Replaces IAudioInformationExtracter::ExtractSpectrum() with our own analysis.
+// Takes the 16-bit PCM delivered by ExtractResampled(), cuts it into
+// overlapping frames and hands the magnitude spectrum of every frame to an
+// IAudioSpectrumReceiver, exactly like the decoder's spectrum path does.
+// Several sources are analyzed in the same pass, each with its own receiver.
+class PcmSpectrumEngine : public kugou::CUnknown, public IAudioSampleReceiver
+{
+public:
+    // Sources that are not a single channel index. Mid and side need at least
+    // two channels and are made of the first two.
+    enum MixedSource
+    {
+        kMid = -1,
+        kSide = -2,
+        kDownmix = -3
+    };
+
+    // |overlapPercent| of every frame is shared with the next one.
+    PcmSpectrumEngine(int fftSize, int overlapPercent);
+    virtual ~PcmSpectrumEngine();
+
+    DELEGATE_IUNKNOWN;
+    virtual int __stdcall GetBlockAlign(int sampleRate) const;
+    virtual bool __stdcall Receive(IAudioSample* samples);
+
+    int GetFftSize() const { return fft_.GetSize(); }
+    int GetHopSize() const { return hop_; }
+
+    // Analyzes |sources|, channel indexes or MixedSource values, of the
+    // following stream into the matching |receivers| and drops the samples
+    // left over from the previous one. The stream stops once every receiver
+    // has declined further frames.
+    void Start(const int* sources, int count,
+               IAudioSpectrumReceiver** receivers);
+
+private:
+    class Spectrum;
+
+    DISALLOW_COPY_AND_ASSIGN(PcmSpectrumEngine);
+
+    bool AnalyzePending();
+
+    RealFft fft_;
+    int hop_;
+    std::vector<int> sources_;
+    std::vector<IAudioSpectrumReceiver*> receivers_;
+    std::vector<char> active_;
+
+    // One plane of GetFftSize() samples per source, back to back, so that
+    // every FFT reads a contiguous frame.
+    std::vector<float> pending_;
+    int pendingFrames_;
+    std::vector<float> magnitudes_;
+
+    // The bins of all sources share one block as well, every Spectrum is a
+    // view of its own part.
+    std::vector<int> frequencies_;
+    std::vector<scoped_refptr<Spectrum>> spectra_;
+};
+
+#endif  // _PCM_SPECTRUM_ENGINE_H_
@@ -0,0 +1,175 @@
+#include "pcm_spectrum_engine.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "cutoff_detector.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+const double pi = 3.14159265358979323846;
+const int fftSize = 1024;
+const int overlapPercent = 50;
+const int checkPointInterval = 20;
+
+// 16-bit interleaved PCM, the way ExtractResampled() delivers it.
+class FakeSample : public kugou::CUnknown, public IAudioSample
+{
+public:
+    FakeSample(int channels, const vector<int16>& pcm)
+        : kugou::CUnknown(NULL, NULL)
+        , channels_(channels)
+        , pcm_(pcm)
+    {
+    }
+
+    DELEGATE_IUNKNOWN;
+    virtual void __stdcall Init(int32 bitsPerSample, int32 channels,
+                                int32 samples, int32 sampleRate) {}
+    virtual void __stdcall SetAvailableSamples(int32 samples) {}
+    virtual int __stdcall GetBitsPerSample() const { return 16; }
+    virtual int __stdcall GetChannels() const { return channels_; }
+    virtual int __stdcall GetSampleRate() const { return 44100; }
+    virtual int __stdcall GetSampleCount() const
+    {
+        return static_cast<int>(pcm_.size()) / channels_;
+    }
+    virtual void* __stdcall GetSamples() const
+    {
+        return const_cast<int16*>(&pcm_[0]);
+    }
+
+private:
+    int channels_;
+    vector<int16> pcm_;
+};
+
+// Does per frame what the receivers of AudioQualityIdent do: accumulates
+// into a CutoffDetector and keeps the cutoff of every checkpoint interval.
+class DetectingReceiver : public kugou::CUnknown, public IAudioSpectrumReceiver
+{
+public:
+    explicit DetectingReceiver(int maxCheckPoints)
+        : kugou::CUnknown(NULL, NULL)
+        , detector_(CutoffDetector::Create(CutoffDetector::kMagnitudeRatio))
+        , bins_(0)
+        , frames_(0)
+        , cutoffs_()
+    {
+        cutoffs_.reserve(maxCheckPoints);
+    }
+
+    DELEGATE_IUNKNOWN;
+    virtual bool __stdcall Receive(IAudioSpectrum* spectrum)
+    {
+        const int bins = spectrum->GetFrequenciesCount();
+        if (bins != bins_) {
+            detector_->Reset(bins);
+            bins_ = bins;
+        }
+
+        detector_->Accumulate(spectrum->GetFrequencies());
+        if (!(++frames_ % checkPointInterval)) {
+            cutoffs_.push_back(detector_->FindCutoffIndex());
+            detector_->Reset(bins);
+        }
+
+        return true;
+    }
+
+    void Clear()
+    {
+        frames_ = 0;
+        cutoffs_.clear();
+        if (bins_)
+            detector_->Reset(bins_);
+    }
+
+    int GetFrames() const { return frames_; }
+    const vector<int>& GetCutoffs() const { return cutoffs_; }
+
+private:
+    unique_ptr<CutoffDetector> detector_;
+    int bins_;
+    int frames_;
+    vector<int> cutoffs_;
+};
+
+// Every channel carries the sum of the sines that fall exactly on the bins
+// 1 to |topBin|, with random phases.
+vector<int16> MakeBandLimited(int channels, int frames, int topBin)
+{
+    vector<double> phases(topBin + 1);
+    for (int k = 1; k <= topBin; ++k)
+        phases[k] = 2 * pi * rand() / RAND_MAX;
+
+    vector<int16> pcm(frames * channels);
+    for (int i = 0; i < frames; ++i) {
+        double sum = 0.0;
+        for (int k = 1; k <= topBin; ++k)
+            sum += sin(2 * pi * k * i / fftSize + phases[k]);
+
+        for (int c = 0; c < channels; ++c)
+            pcm[i * channels + c] = static_cast<int16>(sum * 1000 / topBin);
+    }
+
+    return pcm;
+}
+}
+
+TEST(PcmSpectrumEngineTest, FramesOverlap)
+{
+    scoped_refptr<PcmSpectrumEngine> engine(
+        new PcmSpectrumEngine(fftSize, overlapPercent));
+    EXPECT_EQ(fftSize / 2, engine->GetHopSize());
+
+    const int frames = fftSize * 10 + 100;
+    FakeSample sample(1, vector<int16>(frames, 100));
+    DetectingReceiver receiver(16);
+    IAudioSpectrumReceiver* receivers[] = { &receiver };
+    const int sources[] = { 0 };
+    engine->Start(sources, 1, receivers);
+    EXPECT_TRUE(engine->Receive(&sample));
+    EXPECT_EQ((frames - fftSize) / engine->GetHopSize() + 1,
+              receiver.GetFrames());
+}
+
+// Once an engine and its receivers have analyzed one file, the next one of
+// the same layout must not touch the heap. Checked per thread, so whatever
+// else the process does meanwhile does not count.
+TEST(PcmSpectrumEngineTest, NoAllocationsAfterWarmUp)
+{
+    srand(2);
+    FakeSample first(2, MakeBandLimited(2, fftSize * 24, 300));
+    FakeSample second(2, MakeBandLimited(2, fftSize * 40, 150));
+    scoped_refptr<PcmSpectrumEngine> engine(
+        new PcmSpectrumEngine(fftSize, overlapPercent));
+    DetectingReceiver mid(16);
+    DetectingReceiver side(16);
+    DetectingReceiver left(16);
+    IAudioSpectrumReceiver* receivers[] = { &mid, &side, &left };
+    const int sources[] = {
+        PcmSpectrumEngine::kMid, PcmSpectrumEngine::kSide, 0
+    };
+
+    engine->Start(sources, arraysize(sources), receivers);
+    ASSERT_TRUE(engine->Receive(&first));
+
+    mid.Clear();
+    side.Clear();
+    left.Clear();
+    const int64 before = GetThreadAllocationCount();
+    engine->Start(sources, arraysize(sources), receivers);
+    const bool received = engine->Receive(&second);
+    const int64 allocations = GetThreadAllocationCount() - before;
+
+    EXPECT_TRUE(received);
+    EXPECT_FALSE(left.GetCutoffs().empty());
+    EXPECT_EQ(0, allocations);
+}
@@ -1,23 +1,30 @@
 #include "persistent_map.h"
 
+#include <algorithm>
 #include <memory>
 #include <fstream>
 
 #include <boost/filesystem.hpp>
-#include <boost/archive/xml_oarchive.hpp>
 #include <boost/archive/xml_iarchive.hpp>
 #include <boost/archive/archive_exception.hpp>
+#include <boost/serialization/version.hpp>
 #include <windows.h>
 
+#include "binary_archive.h"
+#include "result_journal.h"
+#include "third_party/chromium/base/time.h"
+
 using std::unique_ptr;
 using std::basic_string;
 using std::wstring;
 using std::ifstream;
-using std::ofstream;
 using std::shared_ptr;
+using std::vector;
+using std::max;
+using base::AutoLock;
+using base::DelegateSimpleThread;
 using boost::filesystem::path;
 using boost::archive::xml_iarchive;
-using boost::archive::xml_oarchive;
 using boost::archive::archive_exception;
 
 namespace boost
@@ -34,10 +41,22 @@ void serialize(Archive& ar, PersistentMap::MediaInfo& info,
     ar & BOOST_SERIALIZATION_NVP(info.CutoffFreq);
     ar & BOOST_SERIALIZATION_NVP(info.Duration);
     ar & BOOST_SERIALIZATION_NVP(info.Format);
+    if (version > 0)
+        ar & BOOST_SERIALIZATION_NVP(info.Timestamp);
+
+    if (version > 1) {
+        ar & BOOST_SERIALIZATION_NVP(info.Size);
+        ar & BOOST_SERIALIZATION_NVP(info.LastModified);
+    }
+
+    if (version > 2)
+        ar & BOOST_SERIALIZATION_NVP(info.Fingerprint);
 }
 }
 }
 
+BOOST_CLASS_VERSION(PersistentMap::MediaInfo, 3)
+
 namespace for_test
 {
 template <typename T>
@@ -105,9 +124,109 @@ inline wstring GetArchiveFileName(const std::wstring& dir,
     return path(dir + L"/").remove_filename().wstring() + L"/" + fileName;
 }
 
-const wchar_t* defaultArchiveFileName = L"/persistence.xml";
+const wchar_t* defaultArchiveFileName = L"/persistence.bin";
+
+// Stores written before the BinaryArchive. They are only read, the next save
+// goes to |defaultArchiveFileName|.
+const wchar_t* xmlArchiveFileName = L"/persistence.xml";
+
+// The journal of the commits since the store was written, and the one set
+// aside while it is written again.
+const wchar_t* journalFileName = L"/persistence.journal";
+const wchar_t* oldJournalFileName = L"/persistence.journal.old";
+
+// A checkpoint rewrites the whole store, so the journal is allowed to grow to
+// a fraction of it first. That keeps the cost of a commit constant.
+const int64 minCheckpointEntries = 8192;
+const int64 checkpointRatio = 4;
+
+// Older stores were keyed by the bare file name. The first rescan identifies
+// every file again and retires those entries one by one.
+void Apply(const wstring& key, const PersistentMap::MediaInfo& info,
+           PersistentMap::ContainerType* map)
+{
+    const wstring legacyKey = path(key).filename().wstring();
+    (*map)[key] = info;
+    if (legacyKey != key)
+        map->erase(legacyKey);
+}
+
+// Makes what an ofstream wrote to |fullPathName| reach the disk.
+bool FlushFile(const wstring& fullPathName)
+{
+    HANDLE file = CreateFile(fullPathName.c_str(), GENERIC_WRITE, 0, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    const bool flushed = !!FlushFileBuffers(file);
+    CloseHandle(file);
+    return flushed;
+}
+
+bool IsIdentified(const PersistentMap::MediaInfo& info)
+{
+    return !info.Format.empty() && (L"[Unknown]" != info.Format) &&
+        (L"[Crash]" != info.Format);
 }
 
+// The newer result wins. Ties, e.g. between stores that predate the
+// timestamp, go to an identified file, and then to the larger fields, so
+// that every merge order ends with the same store.
+bool IsPreferred(const PersistentMap::MediaInfo& a,
+                 const PersistentMap::MediaInfo& b)
+{
+    if (a.Timestamp != b.Timestamp)
+        return a.Timestamp > b.Timestamp;
+
+    if (IsIdentified(a) != IsIdentified(b))
+        return IsIdentified(a);
+
+    if (a.Format != b.Format)
+        return a.Format > b.Format;
+
+    if (a.SampleRate != b.SampleRate)
+        return a.SampleRate > b.SampleRate;
+
+    if (a.Bitrate != b.Bitrate)
+        return a.Bitrate > b.Bitrate;
+
+    if (a.Channels != b.Channels)
+        return a.Channels > b.Channels;
+
+    if (a.CutoffFreq != b.CutoffFreq)
+        return a.CutoffFreq > b.CutoffFreq;
+
+    return a.Duration > b.Duration;
+}
+
+void ReportError(const char* message)
+{
+    if (PersistentMapGlobal::GetInstance()->IsInteractive())
+        MessageBoxA(NULL, message, "ERROR", MB_OK);
+}
+}
+
+//------------------------------------------------------------------------------
+class PersistentMap::Checkpointer : public DelegateSimpleThread::Delegate
+{
+public:
+    explicit Checkpointer(PersistentMap* map) : map_(map) {}
+
+    virtual void Run()
+    {
+        map_->Checkpoint();
+
+        AutoLock lock(map_->lock_);
+        map_->checkpointing_ = false;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Checkpointer);
+
+    PersistentMap* map_;
+};
+
 shared_ptr<PersistentMap> PersistentMap::CreateInstance(const wstring& dir)
 {
     shared_ptr<PersistentMap> rv(new PersistentMap(dir));
@@ -117,40 +236,224 @@ shared_ptr<PersistentMap> PersistentMap::CreateInstance(const wstring& dir)
 
 PersistentMap::~PersistentMap()
 {
-    SerializeNow(defaultArchiveFileName);
+    if (!Save())
+        ReportError("Failed to save analyzing result.");
+}
+
+bool PersistentMap::Save()
+{
+    if (checkpointThread_) {
+        checkpointThread_->Join();
+        checkpointThread_.reset();
+    }
+
+    // What has been committed is on the disk already, only changes the
+    // journal does not have make the whole store to be written.
+    if (journal_ && !journal_->Flush())
+        snapshotNeeded_ = true;
+
+    if (loadFailed_)
+        return false;
+
+    return !snapshotNeeded_ || Checkpoint();
+}
+
+bool PersistentMap::IsUpToDate(const wstring& key, int64 size,
+                               int64 lastModified)
+{
+    base::AutoLock lock(lock_);
+    auto existing = map_.find(key);
+    return (existing != map_.end()) && (existing->second.Size == size) &&
+        (existing->second.LastModified == lastModified);
+}
+
+void PersistentMap::Commit(const wstring& key, const MediaInfo& info)
+{
+    MediaInfo stamped(info);
+    stamped.Timestamp = base::Time::Now().ToInternalValue();
+
+    base::AutoLock lock(lock_);
+    Apply(key, stamped, &map_);
+    if (!journal_) {
+        snapshotNeeded_ = true;
+        return;
+    }
+
+    journal_->Append(key, stamped);
+    if (checkpointing_ ||
+        (journal_->GetEntries() <
+         max(minCheckpointEntries,
+             static_cast<int64>(map_.size()) / checkpointRatio)))
+        return;
+
+    // The previous thread has finished, it only had to be joined.
+    if (checkpointThread_)
+        checkpointThread_->Join();
+
+    checkpointing_ = true;
+    checkpointThread_.reset(
+        new DelegateSimpleThread(checkpointer_.get(), "Checkpoint"));
+    checkpointThread_->Start();
+}
+
+void PersistentMap::Merge(const ContainerType& other)
+{
+    for (auto i = other.begin(), e = other.end(); i != e; ++i) {
+        auto existing = map_.find(i->first);
+        if (existing == map_.end())
+            map_.insert(*i);
+        else if (IsPreferred(i->second, existing->second))
+            existing->second = i->second;
+    }
+
+    snapshotNeeded_ = true;
+}
+
+bool PersistentMap::Load(const wstring& dir, ContainerType* map)
+{
+    const wchar_t* fileNames[] = {
+        defaultArchiveFileName, xmlArchiveFileName, journalFileName,
+        oldJournalFileName
+    };
+
+    for (int i = 0; i < arraysize(fileNames); ++i) {
+        if (boost::filesystem::exists(GetArchiveFileName(dir, fileNames[i]))) {
+            if (!ReadStore(dir, map))
+                return false;
+
+            int64 journalSize;
+            int64 journalEntries;
+            ReplayJournals(dir, map, &journalSize, &journalEntries);
+            return true;
+        }
+    }
+
+    return false;
 }
 
 PersistentMap::PersistentMap(const std::wstring& dir)
     : dir_(dir)
+    , lock_()
     , map_()
+    , journal_()
+    , loadFailed_(false)
+    , snapshotNeeded_(false)
+    , checkpointing_(false)
+    , checkpointer_(new Checkpointer(this))
+    , checkpointThread_()
 {
-    // Setting locale is important for saving non-ascii characters.
+    // Setting locale is important for non-ascii characters in XML stores.
     setlocale(LC_ALL, "chs");
 
-    ifstream inFile(GetArchiveFileName(dir_, defaultArchiveFileName).c_str());
-    if (inFile.good()) {
-        try {
-            xml_iarchive inArch(inFile);
-            inArch >> BOOST_SERIALIZATION_NVP(map_);
-        } catch (const archive_exception&) {
-            MessageBoxA(NULL,
-                        "Failed to load analyzing result.", "ERROR", MB_OK);
-        }
+    // A store that cannot be read is left alone, and so are its journals.
+    // Opening the journal would cut it short, and a checkpoint would replace
+    // the store. The results of the session are kept in memory only.
+    if (!ReadStore(dir_, &map_)) {
+        map_.clear();
+        loadFailed_ = true;
+        ReportError("Failed to load analyzing result.");
+        return;
+    }
+
+    int64 journalSize = 0;
+    int64 journalEntries = 0;
+    ReplayJournals(dir_, &map_, &journalSize, &journalEntries);
+
+    // An imported store is written anew, and so is one whose last checkpoint
+    // did not finish, to be done with the journal it set aside.
+    snapshotNeeded_ =
+        (!boost::filesystem::exists(
+            GetArchiveFileName(dir_, defaultArchiveFileName)) &&
+         boost::filesystem::exists(
+             GetArchiveFileName(dir_, xmlArchiveFileName))) ||
+        boost::filesystem::exists(
+            GetArchiveFileName(dir_, oldJournalFileName));
+
+    // Without a journal the results are only saved at the end, as they used
+    // to be.
+    journal_.reset(
+        new ResultJournal(GetArchiveFileName(dir_, journalFileName)));
+    if (!journal_->Start(journalSize, journalEntries)) {
+        journal_.reset();
+        snapshotNeeded_ = true;
     }
 }
 
-void PersistentMap::SerializeNow(const wchar_t* fileName)
+bool PersistentMap::ReadStore(const wstring& dir, ContainerType* map)
 {
-    ofstream outFile(GetArchiveFileName(dir_, fileName).c_str());
-    if (outFile.good()) {
-        try {
-            xml_oarchive outArch(outFile);
-            outArch << BOOST_SERIALIZATION_NVP(map_);
-        } catch (const archive_exception&) {
-            MessageBoxA(NULL,
-                        "Failed to save analyzing result.", "ERROR", MB_OK);
+    const wstring archive = GetArchiveFileName(dir, defaultArchiveFileName);
+    if (boost::filesystem::exists(archive)) {
+        if (!BinaryArchive::Read(archive, map))
+            return false;
+    } else {
+        ifstream inFile(GetArchiveFileName(dir, xmlArchiveFileName).c_str());
+        if (inFile.good()) {
+            try {
+                xml_iarchive inArch(inFile);
+                inArch >> boost::serialization::make_nvp("map_", *map);
+            } catch (const archive_exception&) {
+                return false;
+            }
         }
     }
+
+    return true;
+}
+
+void PersistentMap::ReplayJournals(const wstring& dir, ContainerType* map,
+                                   int64* journalSize, int64* journalEntries)
+{
+    // The journal set aside by an unfinished checkpoint goes first. Entries
+    // the store has already are replayed with the same outcome.
+    vector<ResultJournal::Entry> entries;
+    ResultJournal::Read(GetArchiveFileName(dir, oldJournalFileName), &entries,
+                        NULL);
+    const size_t oldEntries = entries.size();
+    *journalSize = 0;
+    ResultJournal::Read(GetArchiveFileName(dir, journalFileName), &entries,
+                        journalSize);
+    *journalEntries = static_cast<int64>(entries.size() - oldEntries);
+    for (auto i = entries.begin(), e = entries.end(); i != e; ++i)
+        Apply(i->Key, i->Info, map);
+}
+
+bool PersistentMap::Checkpoint()
+{
+    const wstring archive = GetArchiveFileName(dir_, defaultArchiveFileName);
+    const wstring oldJournal = GetArchiveFileName(dir_, oldJournalFileName);
+    ContainerType snapshot;
+    {
+        base::AutoLock lock(lock_);
+
+        // A journal left aside by a checkpoint that did not finish is still
+        // needed. The current one is then kept as well, and is folded in by
+        // the next checkpoint.
+        if (journal_ && !boost::filesystem::exists(oldJournal))
+            journal_->Rotate(oldJournal);
+
+        snapshot = map_;
+        snapshotNeeded_ = false;
+    }
+
+    // The old journal may only go once the new store is on the disk under
+    // its name, or a crash in between loses the entries it held.
+    const wstring temp = archive + L".tmp";
+    if (!BinaryArchive::Write(temp, snapshot) || !FlushFile(temp) ||
+        !MoveFileEx(temp.c_str(), archive.c_str(),
+                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        base::AutoLock lock(lock_);
+        snapshotNeeded_ = true;
+        return false;
+    }
+
+    DeleteFile(oldJournal.c_str());
+    return true;
+}
+
+void PersistentMap::SerializeNow(const wchar_t* fileName)
+{
+    if (!BinaryArchive::Write(GetArchiveFileName(dir_, fileName), map_))
+        ReportError("Failed to save analyzing result.");
 }
 
 //------------------------------------------------------------------------------
@@ -162,14 +465,26 @@ PersistentMapGlobal* PersistentMapGlobal::GetInstance()
 void PersistentMapGlobal::EmergencySerialize()
 {
     shared_ptr<PersistentMap> m = globalRef_.Get().lock();
-    if (m) {
+    if (!m)
+        return;
+
+    // The journal has everything but the last batch, the map is left alone.
+    if (m->journal_) {
+        m->journal_->FlushNow();
+    } else {
         // Data in the map maybe corrupted, save to another file.
-        m->SerializeNow(L"emergency_archive.xml");
+        m->SerializeNow(L"emergency_archive.bin");
     }
 }
 
+void PersistentMapGlobal::SetInteractive(bool interactive)
+{
+    interactive_ = interactive;
+}
+
 PersistentMapGlobal::PersistentMapGlobal()
     : globalRef_()
+    , interactive_(true)
 {
 }
 
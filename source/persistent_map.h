@@ -2,14 +2,18 @@
 #define _PERSISTENT_MAP_H_
 
 #include <memory>
+#include <string>
 
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/string.hpp>
 
 #include "third_party/chromium/base/memory/singleton.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/threading/simple_thread.h"
 #include "third_party/multimedia_core/common/multi_thread_pointer_transfer.h"
 
 class PersistentMapGlobal;
+class ResultJournal;
 class PersistentMap
 {
 public:
@@ -25,6 +29,10 @@ public:
             , CutoffFreq(0)
             , Duration(0)
             , Format(L"[Unknown]")
+            , Timestamp(0)
+            , Size(0)
+            , LastModified(0)
+            , Fingerprint()
         {
         }
 
@@ -36,6 +44,10 @@ public:
             , CutoffFreq(cutoffFreq)
             , Duration(duration)
             , Format(format)
+            , Timestamp(0)
+            , Size(0)
+            , LastModified(0)
+            , Fingerprint()
         {
         }
 
@@ -45,25 +57,89 @@ public:
         int CutoffFreq;
         int64 Duration;
         std::wstring Format;
+
+        // base::Time internal value of the commit, zero in stores written
+        // before it was recorded. Decides which result a merge keeps.
+        int64 Timestamp;
+
+        // The file as it was identified, FILETIME for |LastModified|. Both
+        // are zero in stores written before they were recorded.
+        int64 Size;
+        int64 LastModified;
+
+        // ContentFingerprint of the file, empty unless deduplication was on.
+        std::string Fingerprint;
     };
 
     typedef std::map<std::wstring, MediaInfo> ContainerType;
 
     ~PersistentMap();
 
+    // Not synchronized. Only for use when no identification is in progress.
     ContainerType& GetMap() { return map_; }
 
+    // Thread-safe accessors used while identification is running. Keys are
+    // full path names. A file is up to date if the store has it with the
+    // same size and modification time, a commit replaces an outdated entry.
+    // Commits go to the ResultJournal, which is folded into the store in the
+    // background once it has grown to a quarter of it.
+    bool IsUpToDate(const std::wstring& key, int64 size, int64 lastModified);
+    void Commit(const std::wstring& key, const MediaInfo& info);
+
+    // Not synchronized either. Takes every entry of |other| whose key is new,
+    // or that is preferred over the entry already present. The outcome does
+    // not depend on the order in which stores are merged.
+    void Merge(const ContainerType& other);
+
+    // Not synchronized either. Writes what the journal does not have yet,
+    // and the whole store if it holds changes the journal never saw. Returns
+    // false if the store is not on the disk as it is in memory, which is
+    // always the case if it could not be read. Called by the destructor as
+    // well, which reports a failure.
+    bool Save();
+
+    // Reads the store in |dir|, and its journal, without making it the
+    // current instance. Returns false if there is no store or it cannot be
+    // read.
+    static bool Load(const std::wstring& dir, ContainerType* map);
+
 private:
+    class Checkpointer;
     friend class PersistentMapGlobal;
 
     DISALLOW_COPY_AND_ASSIGN(PersistentMap);
 
     explicit PersistentMap(const std::wstring& dir);
 
+    // Reads the store, if there is one. Returns false if it cannot be read.
+    static bool ReadStore(const std::wstring& dir, ContainerType* map);
+
+    // Replays the journals on top of the store. The journal entries up to
+    // |journalSize| bytes are kept, |journalEntries| of them.
+    static void ReplayJournals(const std::wstring& dir, ContainerType* map,
+                               int64* journalSize, int64* journalEntries);
+
+    // Sets the journal aside, writes the whole store, and removes the
+    // journal once the store is complete. A process ended meanwhile still
+    // has the previous store and both journals.
+    bool Checkpoint();
     void SerializeNow(const wchar_t* fileName);
 
     std::wstring dir_;
+    base::Lock lock_;
     ContainerType map_;
+    std::unique_ptr<ResultJournal> journal_;
+
+    // The store could not be read. Nothing is written to |dir_| then, so that
+    // the store and its journals stay as they were for someone to recover.
+    bool loadFailed_;
+
+    // The map holds changes the journals do not, e.g. from a merge or an
+    // import, or the last checkpoint has failed.
+    bool snapshotNeeded_;
+    bool checkpointing_;
+    std::unique_ptr<Checkpointer> checkpointer_;
+    std::unique_ptr<base::DelegateSimpleThread> checkpointThread_;
 };
 
 //------------------------------------------------------------------------------
@@ -74,6 +150,12 @@ public:
 
     void EmergencySerialize();
 
+    // Whether failures to load or save a store are shown in a message box.
+    // Batch runs turn it off before they open any store, as nobody would be
+    // there to close the box.
+    void SetInteractive(bool interactive);
+    bool IsInteractive() const { return interactive_; }
+
 private:
     friend struct DefaultSingletonTraits<PersistentMapGlobal>;
     friend class PersistentMap;
@@ -85,6 +167,7 @@ private:
     void SetCurrentInstance(const std::shared_ptr<PersistentMap>& inst);
 
     CSpinLockPointerTransfer<std::weak_ptr<PersistentMap>> globalRef_;
+    bool interactive_;
 };
 
 #endif  // _PERSISTENT_MAP_H_
\ No newline at end of file
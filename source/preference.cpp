@@ -3,10 +3,12 @@
 #include <memory>
 
 #include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
 
 using std::wstring;
 using std::unique_ptr;
 using boost::filesystem::path;
+using boost::lexical_cast;
 
 namespace {
 wstring GetStorageFilePathName()
@@ -18,6 +20,29 @@ wstring GetStorageFilePathName()
 
 const wchar_t* audioLoc = L"audio_location";
 const wchar_t* resultLoc = L"result_location";
+const wchar_t* workerCount = L"worker_count";
+const wchar_t* cutoffDetector = L"cutoff_detector";
+const wchar_t* sampledWindows = L"sampled_windows";
+const wchar_t* windowFrames = L"window_frames";
+const wchar_t* convergenceTolerance = L"convergence_tolerance";
+const wchar_t* convergenceCheckPoints = L"convergence_checkpoints";
+const wchar_t* spectrumEngine = L"spectrum_engine";
+const wchar_t* fftSize = L"fft_size";
+const wchar_t* fftOverlap = L"fft_overlap";
+const wchar_t* decoderBackend = L"decoder_backend";
+const wchar_t* decoderLatency = L"decoder_latency";
+const wchar_t* channelMode = L"channel_mode";
+const wchar_t* prefetchBudget = L"prefetch_budget";
+const wchar_t* isolationTimeout = L"isolation_timeout";
+const wchar_t* allowedExtensions = L"allowed_extensions";
+const wchar_t* deniedExtensions = L"denied_extensions";
+const wchar_t* deduplication = L"deduplication";
+
+const wchar_t* defaultAllowedExtensions =
+    L"mp3;mp2;flac;ape;wav;ogg;oga;opus;m4a;mp4;aac;wma;wv;tta;aif;aiff";
+const wchar_t* defaultDeniedExtensions =
+    L"jpg;jpeg;png;gif;bmp;cue;log;nfo;txt;lrc;krc;m3u;m3u8;pls;db;ini;url;"
+    L"pdf;sfv;md5;accurip";
 }
 
 Preference* Preference::GetInstance()
@@ -32,16 +57,82 @@ Preference::~Preference()
                               storageFile_.c_str());
     WritePrivateProfileString(appName, resultLoc, resultDir_.c_str(),
                               storageFile_.c_str());
+    WriteProfileInt(appName, workerCount, workerCount_);
+    WriteProfileInt(appName, cutoffDetector, cutoffDetector_);
+    WriteProfileInt(appName, sampledWindows, sampledWindows_);
+    WriteProfileInt(appName, windowFrames, windowFrames_);
+    WriteProfileInt(appName, convergenceTolerance, convergenceTolerance_);
+    WriteProfileInt(appName, convergenceCheckPoints, convergenceCheckPoints_);
+    WriteProfileInt(appName, spectrumEngine, spectrumEngine_);
+    WriteProfileInt(appName, fftSize, fftSize_);
+    WriteProfileInt(appName, fftOverlap, fftOverlap_);
+    WriteProfileInt(appName, decoderBackend, decoderBackend_);
+    WriteProfileInt(appName, decoderLatency, decoderLatency_);
+    WriteProfileInt(appName, channelMode, channelMode_);
+    WriteProfileInt(appName, prefetchBudget, prefetchBudget_);
+    WriteProfileInt(appName, isolationTimeout, isolationTimeout_);
+    WritePrivateProfileString(appName, allowedExtensions,
+                              allowedExtensions_.c_str(),
+                              storageFile_.c_str());
+    WritePrivateProfileString(appName, deniedExtensions,
+                              deniedExtensions_.c_str(), storageFile_.c_str());
+    WriteProfileInt(appName, deduplication, deduplication_);
 }
 
 Preference::Preference()
     : storageFile_(GetStorageFilePathName())
     , audioDir_()
     , resultDir_()
+    , workerCount_(0)
+    , cutoffDetector_(CutoffDetector::kLogPower)
+    , sampledWindows_(0)
+    , windowFrames_(200)
+    , convergenceTolerance_(0)
+    , convergenceCheckPoints_(10)
+    , spectrumEngine_(IdentificationModes::kDecoderSpectrum)
+    , fftSize_(1024)
+    , fftOverlap_(0)
+    , decoderBackend_(DecoderBackend::kMultimediaCore)
+    , decoderLatency_(0)
+    , channelMode_(IdentificationModes::kFirstChannel)
+    , prefetchBudget_(256)
+    , isolationTimeout_(0)
+    , allowedExtensions_()
+    , deniedExtensions_()
+    , deduplication_(IdentificationModes::kConfirmedContent)
 {
     const wchar_t* appName = L"CONFIG";
     audioDir_ = GetProfileString(appName, audioLoc, L"");
     resultDir_ = GetProfileString(appName, resultLoc, L"");
+    workerCount_ = GetProfileInt(appName, workerCount, 0);
+    cutoffDetector_ = static_cast<CutoffDetector::Type>(
+        GetProfileInt(appName, cutoffDetector, CutoffDetector::kLogPower));
+    sampledWindows_ = GetProfileInt(appName, sampledWindows, 0);
+    windowFrames_ = GetProfileInt(appName, windowFrames, 200);
+    convergenceTolerance_ = GetProfileInt(appName, convergenceTolerance, 0);
+    convergenceCheckPoints_ =
+        GetProfileInt(appName, convergenceCheckPoints, 10);
+    spectrumEngine_ = static_cast<IdentificationModes::SpectrumEngine>(
+        GetProfileInt(appName, spectrumEngine,
+                      IdentificationModes::kDecoderSpectrum));
+    fftSize_ = GetProfileInt(appName, fftSize, 1024);
+    fftOverlap_ = GetProfileInt(appName, fftOverlap, 0);
+    decoderBackend_ = static_cast<DecoderBackend::Type>(
+        GetProfileInt(appName, decoderBackend,
+                      DecoderBackend::kMultimediaCore));
+    decoderLatency_ = GetProfileInt(appName, decoderLatency, 0);
+    channelMode_ = static_cast<IdentificationModes::ChannelMode>(
+        GetProfileInt(appName, channelMode,
+                      IdentificationModes::kFirstChannel));
+    prefetchBudget_ = GetProfileInt(appName, prefetchBudget, 256);
+    isolationTimeout_ = GetProfileInt(appName, isolationTimeout, 0);
+    allowedExtensions_ = GetProfileString(appName, allowedExtensions,
+                                          defaultAllowedExtensions);
+    deniedExtensions_ = GetProfileString(appName, deniedExtensions,
+                                         defaultDeniedExtensions);
+    deduplication_ = static_cast<IdentificationModes::Deduplication>(
+        GetProfileInt(appName, deduplication,
+                      IdentificationModes::kConfirmedContent));
 }
 
 wstring Preference::GetProfileString(const wchar_t* appName,
@@ -67,4 +158,19 @@ wstring Preference::GetProfileString(const wchar_t* appName,
     result.resize(charCopied);
     memcpy(&result[0], buf.get(), charCopied * sizeof(buf[0]));
     return result;
+}
+
+int Preference::GetProfileInt(const wchar_t* appName, const wchar_t* keyName,
+                              int defaultValue)
+{
+    return GetPrivateProfileInt(appName, keyName, defaultValue,
+                                storageFile_.c_str());
+}
+
+void Preference::WriteProfileInt(const wchar_t* appName,
+                                 const wchar_t* keyName, int value)
+{
+    WritePrivateProfileString(appName, keyName,
+                              lexical_cast<wstring>(value).c_str(),
+                              storageFile_.c_str());
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <string>
 
+#include "cutoff_detector.h"
+#include "decoder_backend.h"
+#include "identification_modes.h"
 #include "third_party/chromium/base/memory/singleton.h"
 
 class Preference
@@ -17,6 +20,88 @@ public:
     const std::wstring& GetResultDir() const { return resultDir_; }
     void SetResultDir(const std::wstring& d) { resultDir_ = d; }
 
+    // Zero means one worker per processor.
+    int GetWorkerCount() const { return workerCount_; }
+    void SetWorkerCount(int c) { workerCount_ = c; }
+
+    CutoffDetector::Type GetCutoffDetector() const { return cutoffDetector_; }
+    void SetCutoffDetector(CutoffDetector::Type t) { cutoffDetector_ = t; }
+
+    // Zero decodes whole tracks instead of sampled windows.
+    int GetSampledWindows() const { return sampledWindows_; }
+    void SetSampledWindows(int w) { sampledWindows_ = w; }
+    int GetWindowFrames() const { return windowFrames_; }
+    void SetWindowFrames(int f) { windowFrames_ = f; }
+
+    // Zero tolerance disables the early exit.
+    int GetConvergenceTolerance() const { return convergenceTolerance_; }
+    void SetConvergenceTolerance(int t) { convergenceTolerance_ = t; }
+    int GetConvergenceCheckPoints() const { return convergenceCheckPoints_; }
+    void SetConvergenceCheckPoints(int c) { convergenceCheckPoints_ = c; }
+
+    IdentificationModes::SpectrumEngine GetSpectrumEngine() const
+    {
+        return spectrumEngine_;
+    }
+    void SetSpectrumEngine(IdentificationModes::SpectrumEngine e)
+    {
+        spectrumEngine_ = e;
+    }
+
+    int GetFftSize() const { return fftSize_; }
+    void SetFftSize(int s) { fftSize_ = s; }
+    int GetFftOverlap() const { return fftOverlap_; }
+    void SetFftOverlap(int o) { fftOverlap_ = o; }
+
+    DecoderBackend::Type GetDecoderBackend() const { return decoderBackend_; }
+    void SetDecoderBackend(DecoderBackend::Type t) { decoderBackend_ = t; }
+
+    // Milliseconds per second of audio, built-in decoder only.
+    int GetDecoderLatency() const { return decoderLatency_; }
+    void SetDecoderLatency(int l) { decoderLatency_ = l; }
+
+    IdentificationModes::ChannelMode GetChannelMode() const
+    {
+        return channelMode_;
+    }
+    void SetChannelMode(IdentificationModes::ChannelMode m)
+    {
+        channelMode_ = m;
+    }
+
+    // In megabytes, zero disables the read-ahead.
+    int GetPrefetchBudget() const { return prefetchBudget_; }
+    void SetPrefetchBudget(int b) { prefetchBudget_ = b; }
+
+    // Seconds a worker process may spend on one file. Zero identifies in
+    // process, where a decoder crash ends the whole scan.
+    int GetIsolationTimeout() const { return isolationTimeout_; }
+    void SetIsolationTimeout(int t) { isolationTimeout_ = t; }
+
+    // Separated by ';', see AudioFileFilter.
+    const std::wstring& GetAllowedExtensions() const
+    {
+        return allowedExtensions_;
+    }
+    void SetAllowedExtensions(const std::wstring& e)
+    {
+        allowedExtensions_ = e;
+    }
+    const std::wstring& GetDeniedExtensions() const
+    {
+        return deniedExtensions_;
+    }
+    void SetDeniedExtensions(const std::wstring& e) { deniedExtensions_ = e; }
+
+    IdentificationModes::Deduplication GetDeduplication() const
+    {
+        return deduplication_;
+    }
+    void SetDeduplication(IdentificationModes::Deduplication d)
+    {
+        deduplication_ = d;
+    }
+
 private:
     friend struct DefaultSingletonTraits<Preference>;
 
@@ -26,10 +111,31 @@ private:
     std::wstring GetProfileString(const wchar_t* appName,
                                   const wchar_t* keyName,
                                   const wchar_t* defaultValue);
+    int GetProfileInt(const wchar_t* appName, const wchar_t* keyName,
+                      int defaultValue);
+    void WriteProfileInt(const wchar_t* appName, const wchar_t* keyName,
+                         int value);
 
     std::wstring storageFile_;
     std::wstring audioDir_;
     std::wstring resultDir_;
+    int workerCount_;
+    CutoffDetector::Type cutoffDetector_;
+    int sampledWindows_;
+    int windowFrames_;
+    int convergenceTolerance_;
+    int convergenceCheckPoints_;
+    IdentificationModes::SpectrumEngine spectrumEngine_;
+    int fftSize_;
+    int fftOverlap_;
+    DecoderBackend::Type decoderBackend_;
+    int decoderLatency_;
+    IdentificationModes::ChannelMode channelMode_;
+    int prefetchBudget_;
+    int isolationTimeout_;
+    std::wstring allowedExtensions_;
+    std::wstring deniedExtensions_;
+    IdentificationModes::Deduplication deduplication_;
 };
 
 #endif  // _PREFERENCE_H_
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "prefetcher.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "async_file_reader.h"
+#include "third_party/chromium/base/file_path.h"
+#include "third_party/chromium/base/platform_file.h"
+
+using std::wstring;
+using std::min;
+using std::max;
+using base::AutoLock;
+using base::DelegateSimpleThread;
+
+namespace {
+// Sequential reads of this size keep a spinning disk streaming.
+const int readChunkSize = 1024 * 1024;
+
+// The asynchronous reader keeps this many reads in flight over a few files,
+// which lets the disk reorder them and keeps an SSD queue busy.
+const int asyncReadDepth = 16;
+const int asyncChunkSize = 256 * 1024;
+const int maxActiveFiles = 4;
+
+// Wake() cuts the wait short, this is only a safety net.
+const int pollInterval = 100;
+}
+
+Prefetcher::Prefetcher(int64 budget)
+    : budget_(budget)
+    , lock_()
+    , changed_(&lock_)
+    , pending_()
+    , warmed_()
+    , charged_(0)
+    , current_()
+    , currentAborted_(false)
+    , stopped_(false)
+    , reader_(NULL)
+    , reading_()
+    , aborted_()
+    , buf_(readChunkSize)
+    , thread_()
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+    Stop();
+}
+
+void Prefetcher::Start()
+{
+    assert(!thread_);
+    thread_.reset(new DelegateSimpleThread(this, "Prefetcher"));
+    thread_->Start();
+}
+
+void Prefetcher::Stop()
+{
+    {
+        AutoLock lock(lock_);
+        stopped_ = true;
+        currentAborted_ = true;
+        changed_.Broadcast();
+        if (reader_)
+            reader_->Wake();
+    }
+
+    if (thread_) {
+        thread_->Join();
+        thread_.reset();
+    }
+}
+
+void Prefetcher::Add(const wstring& fullPathName, int64 size)
+{
+    Entry entry;
+    entry.FullPathName = fullPathName;
+    entry.Size = size;
+
+    AutoLock lock(lock_);
+    pending_.push_back(entry);
+    changed_.Broadcast();
+    if (reader_)
+        reader_->Wake();
+}
+
+void Prefetcher::Release(const wstring& fullPathName)
+{
+    AutoLock lock(lock_);
+    auto warmed = warmed_.find(fullPathName);
+    if (warmed != warmed_.end()) {
+        charged_ -= warmed->second;
+        warmed_.erase(warmed);
+    }
+
+    if (fullPathName == current_)
+        currentAborted_ = true;
+
+    for (auto i = reading_.begin(), e = reading_.end(); i != e; ++i) {
+        if (i->second == fullPathName) {
+            aborted_.push_back(i->first);
+            break;
+        }
+    }
+
+    for (auto i = pending_.begin(), e = pending_.end(); i != e; ++i) {
+        if (i->FullPathName == fullPathName) {
+            pending_.erase(i);
+            break;
+        }
+    }
+
+    changed_.Broadcast();
+    if (reader_)
+        reader_->Wake();
+}
+
+void Prefetcher::Run()
+{
+    AsyncFileReader reader(asyncReadDepth, asyncChunkSize);
+    if (reader.Init())
+        RunAsynchronously(&reader);
+    else
+        RunSynchronously();
+}
+
+void Prefetcher::RunAsynchronously(AsyncFileReader* reader)
+{
+    {
+        AutoLock lock(lock_);
+        reader_ = reader;
+    }
+
+    for (;;) {
+        {
+            AutoLock lock(lock_);
+            for (;;) {
+                if (stopped_) {
+                    // The reader drains what is still in flight on its own.
+                    reader_ = NULL;
+                    reading_.clear();
+                    aborted_.clear();
+                    return;
+                }
+
+                for (size_t i = 0; i < aborted_.size(); ++i)
+                    reader->Abort(aborted_[i]);
+
+                aborted_.clear();
+                while (reader->GetActiveCount() < maxActiveFiles) {
+                    wstring fullPathName;
+                    int64 bytes = 0;
+                    if (!TakeNext(&fullPathName, &bytes))
+                        break;
+
+                    const int id = reader->Add(fullPathName, bytes);
+                    if (id)
+                        reading_[id] = fullPathName;
+                }
+
+                if (reader->GetActiveCount())
+                    break;
+
+                changed_.Wait();
+            }
+        }
+
+        const int done = reader->Poll(pollInterval);
+        if (done) {
+            AutoLock lock(lock_);
+            reading_.erase(done);
+        }
+    }
+}
+
+void Prefetcher::RunSynchronously()
+{
+    for (;;) {
+        wstring fullPathName;
+        int64 bytes = 0;
+        {
+            // Wait for the workers to pick up what has been read already.
+            AutoLock lock(lock_);
+            while (!stopped_ && !TakeNext(&fullPathName, &bytes))
+                changed_.Wait();
+
+            if (stopped_)
+                return;
+
+            current_ = fullPathName;
+            currentAborted_ = false;
+        }
+
+        Warm(fullPathName, bytes);
+
+        AutoLock lock(lock_);
+        current_.clear();
+    }
+}
+
+bool Prefetcher::TakeNext(wstring* fullPathName, int64* bytes)
+{
+    if (pending_.empty())
+        return false;
+
+    auto largest = pending_.begin();
+    for (auto i = pending_.begin(), e = pending_.end(); i != e; ++i) {
+        if (i->Size > largest->Size)
+            largest = i;
+    }
+
+    const int64 size = min(max<int64>(largest->Size, 0), budget_);
+    if (charged_ && (charged_ + size > budget_))
+        return false;
+
+    *fullPathName = largest->FullPathName;
+    *bytes = size;
+    pending_.erase(largest);
+    charged_ += size;
+    warmed_[*fullPathName] += size;
+    return true;
+}
+
+void Prefetcher::Warm(const wstring& fullPathName, int64 bytes)
+{
+    base::PlatformFile file = base::CreatePlatformFile(
+        FilePath(fullPathName),
+        base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_READ, NULL, NULL);
+    if (file == base::kInvalidPlatformFileValue)
+        return;
+
+    for (int64 offset = 0; offset < bytes; ) {
+        if (IsCurrentAborted())
+            break;
+
+        const int size = static_cast<int>(min<int64>(readChunkSize,
+                                                     bytes - offset));
+        const int read = base::ReadPlatformFile(file, offset, &buf_[0], size);
+        if (read <= 0)
+            break;
+
+        offset += read;
+    }
+
+    base::ClosePlatformFile(file);
+}
+
+bool Prefetcher::IsCurrentAborted()
+{
+    AutoLock lock(lock_);
+    return currentAborted_;
+}
@@ -0,0 +1,83 @@
+#ifndef _PREFETCHER_H_
+#define _PREFETCHER_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/base/synchronization/condition_variable.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/threading/simple_thread.h"
+
+//------------------------------------------------------------------------------
+// Reads the files waiting for a worker ahead of time, so that their bytes are
+// in the system cache by the time the decoder opens them and the disk keeps
+// busy while the workers decode. The bytes read but not yet picked up by a
+// worker never exceed |budget|; a file larger than that is only warmed up to
+// the budget. Files are warmed largest first, the order in which the
+// WorkStealingQueue hands them out. Several files are read at once through an
+// AsyncFileReader, or one after the other if that is not available.
+class AsyncFileReader;
+class Prefetcher : public base::DelegateSimpleThread::Delegate
+{
+public:
+    explicit Prefetcher(int64 budget);
+    virtual ~Prefetcher();
+
+    void Start();
+
+    // Stops the thread. Pending files are dropped.
+    void Stop();
+
+    void Add(const std::wstring& fullPathName, int64 size);
+
+    // A worker has picked up |fullPathName|. Its bytes are returned to the
+    // budget, and it is no longer warmed if that has not happened yet.
+    void Release(const std::wstring& fullPathName);
+
+    virtual void Run();
+
+private:
+    struct Entry
+    {
+        std::wstring FullPathName;
+        int64 Size;
+    };
+
+    DISALLOW_COPY_AND_ASSIGN(Prefetcher);
+
+    void RunAsynchronously(AsyncFileReader* reader);
+    void RunSynchronously();
+
+    // Takes the largest pending file if the budget has room for it, and
+    // charges it. Called with |lock_| held.
+    bool TakeNext(std::wstring* fullPathName, int64* bytes);
+
+    // Reads up to |bytes| of the file. Gives up as soon as the file is
+    // released or the prefetcher is stopped.
+    void Warm(const std::wstring& fullPathName, int64 bytes);
+    bool IsCurrentAborted();
+
+    int64 budget_;
+    base::Lock lock_;
+    base::ConditionVariable changed_;
+    std::vector<Entry> pending_;
+
+    // Bytes charged against the budget, by file.
+    std::map<std::wstring, int64> warmed_;
+    int64 charged_;
+    std::wstring current_;
+    bool currentAborted_;
+    bool stopped_;
+
+    // Only set while the asynchronous loop runs.
+    AsyncFileReader* reader_;
+    std::map<int, std::wstring> reading_;
+    std::vector<int> aborted_;
+    std::vector<char> buf_;
+    std::unique_ptr<base::DelegateSimpleThread> thread_;
+};
+
+#endif  // _PREFETCHER_H_
@@ -12,7 +12,8 @@ namespace {
 enum
 {
     kMessageInitializing = WM_USER + 100,
-    kMessageDone
+    kMessageDone,
+    kMessageTotalChanged
 };
 }
 
@@ -34,14 +35,22 @@ ProgressDialog::~ProgressDialog()
 
 void ProgressDialog::Initializing(int totalFiles)
 {
-    assert(totalFiles > 0);
     total_ = totalFiles > 0 ? totalFiles : 1;
     finished_ = 0;
     if (IsWindow(GetSafeHwnd()))
         PostMessage(kMessageInitializing, totalFiles, 0);
 }
 
-bool ProgressDialog::Progress(const std::wstring& current)
+void ProgressDialog::TotalChanged(int totalFiles)
+{
+    // Posted with the value, |total_| may change again before it arrives.
+    total_ = totalFiles > 0 ? totalFiles : 1;
+    if (IsWindow(GetSafeHwnd()))
+        PostMessage(kMessageTotalChanged, total_, 0);
+}
+
+bool ProgressDialog::Progress(const std::wstring& current, int64 size,
+                              int64 lastModified)
 {
     currentFile_.SetWindowText(current.c_str());
     finished_++;
@@ -74,6 +83,7 @@ void ProgressDialog::DoDataExchange(CDataExchange* dataExch)
 BEGIN_MESSAGE_MAP(ProgressDialog, CDialog)
     ON_MESSAGE(kMessageInitializing, OnInitializing)
     ON_MESSAGE(kMessageDone, OnDone)
+    ON_MESSAGE(kMessageTotalChanged, OnTotalChanged)
 END_MESSAGE_MAP()
 
 void ProgressDialog::OnCancel()
@@ -91,7 +101,7 @@ BOOL ProgressDialog::OnInitDialog()
     CDialog::OnInitDialog();
 
     SetWindowText(L"Processing...");
-    currentFile_.SetWindowText(L"Calculating the number of files...");
+    currentFile_.SetWindowText(L"Searching for files...");
     progress_.SetRange32(0, total_);
     return TRUE;
 }
@@ -104,6 +114,16 @@ LRESULT ProgressDialog::OnInitializing(WPARAM w, LPARAM l)
     return 0;
 }
 
+LRESULT ProgressDialog::OnTotalChanged(WPARAM w, LPARAM l)
+{
+    if (progress_.GetSafeHwnd()) {
+        progress_.SetRange32(0, static_cast<int>(w));
+        progress_.SetPos(finished_);
+    }
+
+    return 0;
+}
+
 LRESULT ProgressDialog::OnDone(WPARAM w, LPARAM l)
 {
     total_ = 0;
@@ -21,7 +21,9 @@ public:
     virtual ~ProgressDialog();
 
     virtual void Initializing(int totalFiles);
-    virtual bool Progress(const std::wstring& current);
+    virtual void TotalChanged(int totalFiles);
+    virtual bool Progress(const std::wstring& current, int64 size,
+                          int64 lastModified);
     virtual void Done();
 
     std::shared_ptr<base::CancellationFlag> GetCancellationFlag();
@@ -32,6 +34,7 @@ protected:
     virtual void OnCancel();
     virtual BOOL OnInitDialog();
     virtual LRESULT OnInitializing(WPARAM w, LPARAM l);
+    virtual LRESULT OnTotalChanged(WPARAM w, LPARAM l);
     virtual LRESULT OnDone(WPARAM w, LPARAM l);
 
     DECLARE_MESSAGE_MAP()
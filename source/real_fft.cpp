@@ -0,0 +1,161 @@
+#include "real_fft.h"
+
+#include <cassert>
+#include <cmath>
+
+#include <emmintrin.h>
+
+#include "third_party/chromium/base/cpu.h"
+
+namespace {
+const double pi = 3.14159265358979323846;
+
+bool HasSse2()
+{
+    base::CPU cpu;
+    return !!cpu.has_sse2();
+}
+
+const bool hasSse2 = HasSse2();
+
+// One radix-2 stage over butterflies of span |half|, four at a time.
+void ButterflyStageSse(float* re, float* im, int count, int half,
+                       const float* twiddleCos, const float* twiddleSin)
+{
+    for (int start = 0; start < count; start += half * 2) {
+        float* re0 = re + start;
+        float* im0 = im + start;
+        float* re1 = re0 + half;
+        float* im1 = im0 + half;
+        for (int j = 0; j < half; j += 4) {
+            const __m128 wr = _mm_loadu_ps(twiddleCos + j);
+            const __m128 wi = _mm_loadu_ps(twiddleSin + j);
+            const __m128 br = _mm_loadu_ps(re1 + j);
+            const __m128 bi = _mm_loadu_ps(im1 + j);
+            const __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr),
+                                         _mm_mul_ps(bi, wi));
+            const __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi),
+                                         _mm_mul_ps(bi, wr));
+            const __m128 ar = _mm_loadu_ps(re0 + j);
+            const __m128 ai = _mm_loadu_ps(im0 + j);
+            _mm_storeu_ps(re0 + j, _mm_add_ps(ar, tr));
+            _mm_storeu_ps(im0 + j, _mm_add_ps(ai, ti));
+            _mm_storeu_ps(re1 + j, _mm_sub_ps(ar, tr));
+            _mm_storeu_ps(im1 + j, _mm_sub_ps(ai, ti));
+        }
+    }
+}
+
+void ButterflyStage(float* re, float* im, int count, int half,
+                    const float* twiddleCos, const float* twiddleSin)
+{
+    for (int start = 0; start < count; start += half * 2) {
+        for (int j = 0; j < half; ++j) {
+            const int a = start + j;
+            const int b = a + half;
+            const float tr = re[b] * twiddleCos[j] - im[b] * twiddleSin[j];
+            const float ti = re[b] * twiddleSin[j] + im[b] * twiddleCos[j];
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] += tr;
+            im[a] += ti;
+        }
+    }
+}
+}
+
+RealFft::RealFft(int size)
+    : size_(size)
+    , window_(size)
+    , bitReverse_(size / 2)
+    , stageCos_(size / 2)
+    , stageSin_(size / 2)
+    , splitCos_(size / 2 + 1)
+    , splitSin_(size / 2 + 1)
+    , re_(size / 2)
+    , im_(size / 2)
+{
+    assert(size >= 4);
+    assert(!(size & (size - 1)));
+
+    for (int i = 0; i < size; ++i)
+        window_[i] = static_cast<float>(0.5 - 0.5 * cos(2 * pi * i / size));
+
+    const int half = size / 2;
+    int bits = 0;
+    while ((1 << bits) < half)
+        bits++;
+
+    for (int i = 0; i < half; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+
+        bitReverse_[i] = r;
+    }
+
+    // The stage of span h keeps its h factors at offset h - 1.
+    for (int h = 1; h < half; h *= 2) {
+        for (int j = 0; j < h; ++j) {
+            stageCos_[h - 1 + j] = static_cast<float>(cos(-pi * j / h));
+            stageSin_[h - 1 + j] = static_cast<float>(sin(-pi * j / h));
+        }
+    }
+
+    for (int k = 0; k <= half; ++k) {
+        splitCos_[k] = static_cast<float>(cos(-2 * pi * k / size));
+        splitSin_[k] = static_cast<float>(sin(-2 * pi * k / size));
+    }
+}
+
+RealFft::~RealFft()
+{
+}
+
+void RealFft::ComputeMagnitudes(const float* samples, float* magnitudes)
+{
+    // Pack the even samples into the real and the odd ones into the
+    // imaginary part of a half-size complex sequence.
+    const int half = size_ / 2;
+    for (int i = 0; i < half; ++i) {
+        const int r = bitReverse_[i];
+        re_[r] = samples[2 * i] * window_[2 * i];
+        im_[r] = samples[2 * i + 1] * window_[2 * i + 1];
+    }
+
+    TransformHalf();
+
+    // X[k] = E[k] + W^k * O[k], where E and O are recovered from Z[k] and
+    // conj(Z[half - k]).
+    for (int k = 0; k <= half; ++k) {
+        const int a = (k == half) ? 0 : k;
+        const int b = k ? half - k : 0;
+        const float zr = re_[a];
+        const float zi = im_[a];
+        const float cr = re_[b];
+        const float ci = -im_[b];
+        const float evenRe = 0.5f * (zr + cr);
+        const float evenIm = 0.5f * (zi + ci);
+        const float oddRe = 0.5f * (zi - ci);
+        const float oddIm = -0.5f * (zr - cr);
+        const float xr =
+            evenRe + oddRe * splitCos_[k] - oddIm * splitSin_[k];
+        const float xi =
+            evenIm + oddRe * splitSin_[k] + oddIm * splitCos_[k];
+        magnitudes[k] = sqrt(xr * xr + xi * xi);
+    }
+}
+
+void RealFft::TransformHalf()
+{
+    const int count = size_ / 2;
+    for (int h = 1; h < count; h *= 2) {
+        const float* twiddleCos = &stageCos_[h - 1];
+        const float* twiddleSin = &stageSin_[h - 1];
+        if (hasSse2 && (h >= 4))
+            ButterflyStageSse(&re_[0], &im_[0], count, h, twiddleCos,
+                              twiddleSin);
+        else
+            ButterflyStage(&re_[0], &im_[0], count, h, twiddleCos, twiddleSin);
+    }
+}
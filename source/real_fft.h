@@ -0,0 +1,49 @@
+#ifndef _REAL_FFT_H_
+#define _REAL_FFT_H_
+
+#include <vector>
+
+#include "third_party/chromium/base/basictypes.h"
+
+//------------------------------------------------------------------------------
+// Magnitude spectrum of windowed real frames. Everything that depends only on
+// the frame size (Hann window, bit reversal, twiddles) is planned once in the
+// constructor, so an instance can be reused for every frame of every file.
+// Nothing in here depends on Windows.
+class RealFft
+{
+public:
+    // |size| must be a power of two, at least 4.
+    explicit RealFft(int size);
+    ~RealFft();
+
+    int GetSize() const { return size_; }
+    int GetBinCount() const { return size_ / 2 + 1; }
+
+    // Windows |samples| (GetSize() of them) and writes GetBinCount()
+    // magnitudes.
+    void ComputeMagnitudes(const float* samples, float* magnitudes);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(RealFft);
+
+    void TransformHalf();
+
+    int size_;
+    std::vector<float> window_;
+    std::vector<int> bitReverse_;
+
+    // Per-stage twiddles of the half-size complex transform, laid out so
+    // that every stage reads its factors contiguously.
+    std::vector<float> stageCos_;
+    std::vector<float> stageSin_;
+
+    // Twiddles that split the half-size result into the real spectrum.
+    std::vector<float> splitCos_;
+    std::vector<float> splitSin_;
+
+    std::vector<float> re_;
+    std::vector<float> im_;
+};
+
+#endif  // _REAL_FFT_H_
@@ -0,0 +1,33 @@
+#include "real_fft.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "third_party/chromium/base/time.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::vector;
+
+// One minute of 44.1 kHz audio per frame size, without overlap.
+TEST(RealFftPerfTest, DISABLED_ComputeMagnitudes)
+{
+    const int sampleCount = 44100 * 60;
+    srand(1);
+    vector<float> samples(sampleCount);
+    for (int i = 0; i < sampleCount; ++i)
+        samples[i] = static_cast<float>(rand()) / RAND_MAX * 2 - 1;
+
+    for (int size = 256; size <= 8192; size *= 2) {
+        RealFft fft(size);
+        vector<float> magnitudes(fft.GetBinCount());
+        const int frameCount = sampleCount / size;
+        const base::TimeTicks start = base::TimeTicks::HighResNow();
+        for (int f = 0; f < frameCount; ++f)
+            fft.ComputeMagnitudes(&samples[f * size], &magnitudes[0]);
+
+        const base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+        printf("RealFft(%d): %.2f ms for %d frames\n", size,
+               elapsed.InMillisecondsF(), frameCount);
+    }
+}
@@ -0,0 +1,109 @@
+#include "real_fft.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::vector;
+
+namespace {
+const double pi = 3.14159265358979323846;
+
+// Hann windowed DFT straight from the definition, in double.
+vector<double> NaiveMagnitudes(const vector<float>& samples)
+{
+    const int size = static_cast<int>(samples.size());
+    vector<double> windowed(size);
+    for (int i = 0; i < size; ++i)
+        windowed[i] = samples[i] * (0.5 - 0.5 * cos(2 * pi * i / size));
+
+    vector<double> magnitudes(size / 2 + 1);
+    for (int k = 0; k <= size / 2; ++k) {
+        double re = 0;
+        double im = 0;
+        for (int i = 0; i < size; ++i) {
+            const double angle = 2 * pi * k * i / size;
+            re += windowed[i] * cos(angle);
+            im -= windowed[i] * sin(angle);
+        }
+
+        magnitudes[k] = sqrt(re * re + im * im);
+    }
+
+    return magnitudes;
+}
+
+vector<float> RandomSamples(int size)
+{
+    vector<float> samples(size);
+    for (int i = 0; i < size; ++i)
+        samples[i] = static_cast<float>(rand()) / RAND_MAX * 2 - 1;
+
+    return samples;
+}
+}
+
+TEST(RealFftTest, MatchesNaiveDft)
+{
+    srand(1);
+    for (int size = 4; size <= 4096; size *= 2) {
+        RealFft fft(size);
+        ASSERT_EQ(size, fft.GetSize());
+        ASSERT_EQ(size / 2 + 1, fft.GetBinCount());
+
+        const vector<float> samples = RandomSamples(size);
+        const vector<double> expected = NaiveMagnitudes(samples);
+        vector<float> magnitudes(fft.GetBinCount());
+        fft.ComputeMagnitudes(&samples[0], &magnitudes[0]);
+
+        // Float rounding grows with the transform length.
+        const double tolerance = 1e-5 * size;
+        for (int k = 0; k < fft.GetBinCount(); ++k)
+            EXPECT_NEAR(expected[k], magnitudes[k], tolerance)
+                << "size " << size << " bin " << k;
+    }
+}
+
+TEST(RealFftTest, LocatesTone)
+{
+    const int size = 1024;
+    const int bin = 100;
+    vector<float> samples(size);
+    for (int i = 0; i < size; ++i)
+        samples[i] = static_cast<float>(sin(2 * pi * bin * i / size));
+
+    RealFft fft(size);
+    vector<float> magnitudes(fft.GetBinCount());
+    fft.ComputeMagnitudes(&samples[0], &magnitudes[0]);
+
+    // The Hann window spreads the tone over its bin and the two neighbours:
+    // size / 4 in the middle, size / 8 on either side.
+    EXPECT_NEAR(size / 4.0, magnitudes[bin], 1e-2);
+    EXPECT_NEAR(size / 8.0, magnitudes[bin - 1], 1e-2);
+    EXPECT_NEAR(size / 8.0, magnitudes[bin + 1], 1e-2);
+    for (int k = 0; k < fft.GetBinCount(); ++k) {
+        if (abs(k - bin) > 1) {
+            EXPECT_GT(1e-2, magnitudes[k]) << "bin " << k;
+        }
+    }
+}
+
+TEST(RealFftTest, ReusesPlan)
+{
+    srand(2);
+    const int size = 512;
+    RealFft fft(size);
+    const vector<float> first = RandomSamples(size);
+    const vector<float> second = RandomSamples(size);
+
+    vector<float> expected(fft.GetBinCount());
+    fft.ComputeMagnitudes(&first[0], &expected[0]);
+
+    vector<float> magnitudes(fft.GetBinCount());
+    fft.ComputeMagnitudes(&second[0], &magnitudes[0]);
+    fft.ComputeMagnitudes(&first[0], &magnitudes[0]);
+    for (int k = 0; k < fft.GetBinCount(); ++k)
+        EXPECT_EQ(expected[k], magnitudes[k]);
+}
@@ -0,0 +1,311 @@
+#include "result_journal.h"
+
+#include <cassert>
+#include <fstream>
+
+#include <windows.h>
+
+#include "binary_archive.h"
+#include "third_party/chromium/base/time.h"
+
+using std::wstring;
+using std::vector;
+using std::ifstream;
+using base::AutoLock;
+using base::DelegateSimpleThread;
+using base::TimeDelta;
+
+namespace {
+const int entryHeaderSize = 8;
+
+// Anything larger is not an entry but a damaged size.
+const uint32 maxEntrySize = 1024 * 1024;
+
+// How long the thread waits for more entries before it writes a batch. One
+// flush to the disk costs about as much on a spinning disk.
+const int groupCommitDelay = 50;
+
+uint32 Get32(const char* p)
+{
+    const uint8* b = reinterpret_cast<const uint8*>(p);
+    return b[0] | (b[1] << 8) | (b[2] << 16) |
+        (static_cast<uint32>(b[3]) << 24);
+}
+
+void Put32(uint32 v, char* p)
+{
+    p[0] = static_cast<char>(v);
+    p[1] = static_cast<char>(v >> 8);
+    p[2] = static_cast<char>(v >> 16);
+    p[3] = static_cast<char>(v >> 24);
+}
+
+uint32 Checksum(const char* data, size_t size)
+{
+    uint32 hash = 2166136261U;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ static_cast<uint8>(data[i])) * 16777619U;
+
+    return hash;
+}
+
+HANDLE Open(const wstring& fullPathName, int64 size)
+{
+    HANDLE file = CreateFile(fullPathName.c_str(), GENERIC_WRITE,
+                             FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return file;
+
+    // Whatever lies past |size| is torn, the next batch goes in its place.
+    LARGE_INTEGER offset;
+    offset.QuadPart = size;
+    if (!SetFilePointerEx(file, offset, NULL, FILE_BEGIN) ||
+        !SetEndOfFile(file)) {
+        CloseHandle(file);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    return file;
+}
+}
+
+//------------------------------------------------------------------------------
+ResultJournal::ResultJournal(const wstring& fullPathName)
+    : fullPathName_(fullPathName)
+    , ioLock_()
+    , file_(INVALID_HANDLE_VALUE)
+    , size_(0)
+    , lock_()
+    , changed_(&lock_)
+    , pending_()
+    , entries_(0)
+    , appended_(0)
+    , flushed_(0)
+    , waiters_(0)
+    , failed_(false)
+    , stopped_(false)
+    , thread_()
+{
+}
+
+ResultJournal::~ResultJournal()
+{
+    {
+        AutoLock lock(lock_);
+        stopped_ = true;
+        changed_.Broadcast();
+    }
+
+    // The thread writes what is pending before it ends.
+    if (thread_) {
+        thread_->Join();
+        thread_.reset();
+    }
+
+    if (file_ != INVALID_HANDLE_VALUE)
+        CloseHandle(file_);
+}
+
+bool ResultJournal::Read(const wstring& fullPathName, vector<Entry>* entries,
+                         int64* validSize)
+{
+    ifstream file(fullPathName.c_str(), std::ios::binary);
+    if (!file.good())
+        return false;
+
+    file.seekg(0, std::ios::end);
+    const std::streamoff length = file.tellg();
+    if (length < 0)
+        return false;
+
+    vector<char> buf(static_cast<size_t>(length));
+    file.seekg(0, std::ios::beg);
+    if (!buf.empty())
+        file.read(&buf[0], buf.size());
+
+    if (file.fail())
+        buf.clear();
+
+    size_t offset = 0;
+    while (buf.size() - offset >= entryHeaderSize) {
+        const uint32 size = Get32(&buf[offset]);
+        if (!size || (size > maxEntrySize) ||
+            (size > buf.size() - offset - entryHeaderSize))
+            break;
+
+        const char* payload = &buf[offset + entryHeaderSize];
+        Entry entry;
+        if ((Checksum(payload, size) != Get32(&buf[offset + 4])) ||
+            !BinaryArchive::GetEntry(payload, size, &entry.Key, &entry.Info))
+            break;
+
+        entries->push_back(entry);
+        offset += entryHeaderSize + size;
+    }
+
+    if (validSize)
+        *validSize = offset;
+
+    return true;
+}
+
+bool ResultJournal::Start(int64 validSize, int64 entries)
+{
+    assert(!thread_);
+    file_ = Open(fullPathName_, validSize);
+    if (file_ == INVALID_HANDLE_VALUE)
+        return false;
+
+    size_ = validSize;
+    entries_ = entries;
+    thread_.reset(new DelegateSimpleThread(this, "ResultJournal"));
+    thread_->Start();
+    return true;
+}
+
+void ResultJournal::Append(const wstring& key,
+                           const PersistentMap::MediaInfo& info)
+{
+    vector<char> payload;
+    BinaryArchive::PutEntry(key, info, &payload);
+
+    char header[entryHeaderSize];
+    Put32(static_cast<uint32>(payload.size()), header);
+    Put32(Checksum(&payload[0], payload.size()), header + 4);
+
+    AutoLock lock(lock_);
+    if (pending_.empty())
+        changed_.Broadcast();
+
+    pending_.insert(pending_.end(), header, header + entryHeaderSize);
+    pending_.insert(pending_.end(), payload.begin(), payload.end());
+    entries_++;
+    appended_++;
+}
+
+bool ResultJournal::Flush()
+{
+    AutoLock lock(lock_);
+    const int64 target = appended_;
+    waiters_++;
+    changed_.Broadcast();
+    while ((flushed_ < target) && !failed_)
+        changed_.Wait();
+
+    waiters_--;
+    return !failed_;
+}
+
+void ResultJournal::FlushNow()
+{
+    // The crashed thread may hold either lock.
+    if (!ioLock_.Try())
+        return;
+
+    if (lock_.Try()) {
+        vector<char> batch;
+        batch.swap(pending_);
+        const bool failed = failed_;
+        lock_.Release();
+        if (!failed && !batch.empty())
+            Write(batch);
+    }
+
+    ioLock_.Release();
+}
+
+bool ResultJournal::Rotate(const wstring& oldPathName)
+{
+    AutoLock io(ioLock_);
+
+    // Even if this fails, the entries are in the map, which the caller is
+    // about to write in full.
+    WritePending();
+    if (file_ != INVALID_HANDLE_VALUE)
+        CloseHandle(file_);
+
+    const bool moved = !!MoveFileEx(fullPathName_.c_str(),
+                                    oldPathName.c_str(),
+                                    MOVEFILE_REPLACE_EXISTING |
+                                        MOVEFILE_WRITE_THROUGH);
+    if (moved)
+        size_ = 0;
+
+    file_ = Open(fullPathName_, size_);
+
+    AutoLock lock(lock_);
+    if (moved) {
+        entries_ = 0;
+        failed_ = file_ == INVALID_HANDLE_VALUE;
+    }
+
+    return moved && !failed_;
+}
+
+int64 ResultJournal::GetEntries()
+{
+    AutoLock lock(lock_);
+    return entries_;
+}
+
+void ResultJournal::Run()
+{
+    for (;;) {
+        {
+            AutoLock lock(lock_);
+            while (pending_.empty() && !stopped_)
+                changed_.Wait();
+
+            if (pending_.empty())
+                return;
+
+            // Let the other workers add to the batch, unless someone is
+            // waiting for it.
+            if (!waiters_ && !stopped_)
+                changed_.TimedWait(
+                    TimeDelta::FromMilliseconds(groupCommitDelay));
+        }
+
+        AutoLock io(ioLock_);
+        WritePending();
+    }
+}
+
+bool ResultJournal::WritePending()
+{
+    vector<char> batch;
+    int64 appended;
+    bool failed;
+    {
+        AutoLock lock(lock_);
+        batch.swap(pending_);
+        appended = appended_;
+        failed = failed_;
+    }
+
+    // After a failed write the file may end in a torn entry, which would
+    // hide everything behind it. Nothing more is written until a rotation.
+    if (!failed && !batch.empty())
+        failed = !Write(batch);
+
+    AutoLock lock(lock_);
+    failed_ = failed;
+    if (!failed)
+        flushed_ = appended;
+
+    changed_.Broadcast();
+    return !failed;
+}
+
+bool ResultJournal::Write(const vector<char>& batch)
+{
+    DWORD written = 0;
+    const DWORD size = static_cast<DWORD>(batch.size());
+    if (!WriteFile(file_, &batch[0], size, &written, NULL) ||
+        (written != size) || !FlushFileBuffers(file_))
+        return false;
+
+    size_ += size;
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef _RESULT_JOURNAL_H_
+#define _RESULT_JOURNAL_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "persistent_map.h"
+#include "third_party/chromium/base/synchronization/condition_variable.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/threading/simple_thread.h"
+
+//------------------------------------------------------------------------------
+// Appends every committed result to a file next to the store, so that the
+// store itself only has to be rewritten once in a while. Each entry is its
+// size and an FNV-1a checksum, both 32 bits, followed by the entry as
+// BinaryArchive::PutEntry() writes it. A torn or damaged entry ends the
+// journal, it and anything after it are dropped when the journal is opened.
+//
+// Appending does not wait for the disk. The thread collects what the workers
+// append for a moment and writes it in one go, flushed through to the disk,
+// so a process that is killed loses at most the batch in flight.
+class ResultJournal : public base::DelegateSimpleThread::Delegate
+{
+public:
+    struct Entry
+    {
+        std::wstring Key;
+        PersistentMap::MediaInfo Info;
+    };
+
+    explicit ResultJournal(const std::wstring& fullPathName);
+
+    // Writes what has been appended and closes the journal.
+    virtual ~ResultJournal();
+
+    // Appends the intact entries of the journal at |fullPathName| to
+    // |entries|, and sets |validSize| to the bytes they take, if not NULL.
+    // Returns false if there is no journal.
+    static bool Read(const std::wstring& fullPathName,
+                     std::vector<Entry>* entries, int64* validSize);
+
+    // Opens the journal, keeping its first |validSize| bytes and the
+    // |entries| in them, and starts the thread.
+    bool Start(int64 validSize, int64 entries);
+
+    void Append(const std::wstring& key, const PersistentMap::MediaInfo& info);
+
+    // Waits until everything appended so far is on the disk. Returns false if
+    // a write has failed.
+    bool Flush();
+
+    // For the crash handler. Writes what is pending unless that would mean
+    // waiting for a lock.
+    void FlushNow();
+
+    // Writes what is pending and moves the journal to |oldPathName|, after
+    // which it starts out empty. Must not run alongside Append().
+    bool Rotate(const std::wstring& oldPathName);
+
+    // Entries in the journal, including the ones not yet written.
+    int64 GetEntries();
+
+    virtual void Run();
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ResultJournal);
+
+    // Called with |ioLock_| held.
+    bool WritePending();
+    bool Write(const std::vector<char>& batch);
+
+    std::wstring fullPathName_;
+
+    // Held while writing to |file_|, before |lock_| if both are needed.
+    base::Lock ioLock_;
+    void* file_;
+    int64 size_;
+
+    base::Lock lock_;
+    base::ConditionVariable changed_;
+    std::vector<char> pending_;
+    int64 entries_;
+
+    // Entries appended, and written to the disk, since the start.
+    int64 appended_;
+    int64 flushed_;
+
+    // Threads waiting in Flush(), for which the batch is not held back.
+    int waiters_;
+    bool failed_;
+    bool stopped_;
+    std::unique_ptr<base::DelegateSimpleThread> thread_;
+};
+
+#endif  // _RESULT_JOURNAL_H_
@@ -0,0 +1,152 @@
+#include "result_journal.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/scoped_temp_dir.h"
+#include "third_party/chromium/base/string_number_conversions.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::ofstream;
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace {
+const int entryCount = 10;
+
+PersistentMap::MediaInfo MakeInfo(int i)
+{
+    PersistentMap::MediaInfo info(44100, 320, 2, 16000 + i, i * 1000LL,
+                                  L"MP3");
+    info.Size = i;
+    info.LastModified = i * 3;
+    return info;
+}
+
+wstring MakeKey(int i)
+{
+    return L"C:\\music\\" + base::IntToString16(i) + L".mp3";
+}
+
+class ResultJournalTest : public testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_TRUE(tempDir_.CreateUniqueTempDir());
+        fullPathName_ = tempDir_.path().Append(L"journal.bin").value();
+
+        ResultJournal journal(fullPathName_);
+        ASSERT_TRUE(journal.Start(0, 0));
+        for (int i = 0; i < entryCount; ++i)
+            journal.Append(MakeKey(i), MakeInfo(i));
+
+        ASSERT_TRUE(journal.Flush());
+        EXPECT_EQ(entryCount, journal.GetEntries());
+    }
+
+    void AppendBytes(const string& bytes)
+    {
+        ofstream file(fullPathName_.c_str(),
+                      std::ios::binary | std::ios::app);
+        file.write(bytes.data(), bytes.size());
+    }
+
+    void ExpectEntries(const vector<ResultJournal::Entry>& entries, int count)
+    {
+        ASSERT_EQ(count, static_cast<int>(entries.size()));
+        for (int i = 0; i < count; ++i) {
+            EXPECT_EQ(MakeKey(i), entries[i].Key);
+            EXPECT_EQ(MakeInfo(i).CutoffFreq, entries[i].Info.CutoffFreq);
+            EXPECT_EQ(MakeInfo(i).LastModified, entries[i].Info.LastModified);
+        }
+    }
+
+    ScopedTempDir tempDir_;
+    wstring fullPathName_;
+};
+}
+
+TEST_F(ResultJournalTest, ReplaysEntries)
+{
+    vector<ResultJournal::Entry> entries;
+    int64 validSize = 0;
+    ASSERT_TRUE(ResultJournal::Read(fullPathName_, &entries, &validSize));
+    ExpectEntries(entries, entryCount);
+    EXPECT_LT(0, validSize);
+}
+
+TEST_F(ResultJournalTest, MissingJournal)
+{
+    vector<ResultJournal::Entry> entries;
+    EXPECT_FALSE(ResultJournal::Read(
+        tempDir_.path().Append(L"missing.bin").value(), &entries, NULL));
+}
+
+// A process killed in the middle of a write leaves part of an entry behind:
+// a header whose size runs past the end, a checksum that does not match, or
+// just a few bytes.
+TEST_F(ResultJournalTest, DropsTornTail)
+{
+    vector<ResultJournal::Entry> entries;
+    int64 validSize = 0;
+    ASSERT_TRUE(ResultJournal::Read(fullPathName_, &entries, &validSize));
+
+    const string tails[] = {
+        string("\x40\0\0\0\x12\x34\x56\x78" "abc", 11),
+        string("\x04\0\0\0\x12\x34\x56\x78" "abcd", 12),
+        string("\x07\0", 2)
+    };
+    for (size_t i = 0; i < arraysize(tails); ++i) {
+        AppendBytes(tails[i]);
+        entries.clear();
+        int64 tornSize = 0;
+        ASSERT_TRUE(ResultJournal::Read(fullPathName_, &entries, &tornSize));
+        ExpectEntries(entries, entryCount);
+        EXPECT_EQ(validSize, tornSize);
+    }
+}
+
+TEST_F(ResultJournalTest, DropsEverythingAfterDamagedEntry)
+{
+    vector<ResultJournal::Entry> entries;
+    int64 validSize = 0;
+    ASSERT_TRUE(ResultJournal::Read(fullPathName_, &entries, &validSize));
+
+    // Every entry here is the same size. Flip a byte in the payload of the
+    // fifth.
+    const int64 entrySize = validSize / entryCount;
+    std::fstream file(fullPathName_.c_str(),
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(entrySize * 4 + 12);
+    file.put('\x5a');
+    file.close();
+
+    entries.clear();
+    int64 damagedSize = 0;
+    ASSERT_TRUE(ResultJournal::Read(fullPathName_, &entries, &damagedSize));
+    ExpectEntries(entries, 4);
+    EXPECT_EQ(entrySize * 4, damagedSize);
+}
+
+TEST_F(ResultJournalTest, StartOverwritesTornTail)
+{
+    AppendBytes(string("\x40\0\0\0\x12\x34\x56\x78" "abc", 11));
+
+    vector<ResultJournal::Entry> entries;
+    int64 validSize = 0;
+    ASSERT_TRUE(ResultJournal::Read(fullPathName_, &entries, &validSize));
+    {
+        ResultJournal journal(fullPathName_);
+        ASSERT_TRUE(journal.Start(validSize, entries.size()));
+        journal.Append(MakeKey(entryCount), MakeInfo(entryCount));
+        ASSERT_TRUE(journal.Flush());
+        EXPECT_EQ(entryCount + 1, journal.GetEntries());
+    }
+
+    entries.clear();
+    ASSERT_TRUE(ResultJournal::Read(fullPathName_, &entries, NULL));
+    ExpectEntries(entries, entryCount + 1);
+}
@@ -0,0 +1,13 @@
+#include "third_party/chromium/base/at_exit.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+//------------------------------------------------------------------------------
+// Entry point of audio_quality_identification_unittests. The benchmarks are
+// disabled tests named *Perf*; run them with
+//   --gtest_also_run_disabled_tests --gtest_filter=*Perf*
+int main(int argc, char** argv)
+{
+    base::AtExitManager atExit;
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "cutoff_detector.h"
+#include "window_positions.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::max;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+// The analysis as AudioQualityIdent runs it on the spectrum of the decoder:
+// 1024 point frames of 44.1 kHz, a cutoff every 20 frames, the first and the
+// last 10 s left out.
+const int sampleRate = 44100;
+const int binCount = 513;
+const double framesPerSecond = sampleRate / 1024.0;
+const int checkPointInterval = 20;
+const double headSeconds = 10.0;
+const double tailSeconds = 10.0;
+const int tailCheckPoints = 11;
+const int windowFrames = 200;
+
+// A synthetic track: loud up to its cutoff bin, faint above. Every 5 s
+// passage has a chance of being dull, its content stopping well below the
+// cutoff, the way quiet intros, breaks and spoken parts do.
+class SyntheticTrack
+{
+public:
+    SyntheticTrack(unsigned int seed, double seconds)
+        : seed_(seed)
+        , frames_(static_cast<int>(seconds * framesPerSecond))
+        , tops_()
+    {
+        const int cutoff = 200 + Next() % 300;
+        const int passageFrames = static_cast<int>(5 * framesPerSecond);
+        for (int i = 0; i < frames_; i += passageFrames) {
+            const bool dull = Next() % 5 == 0;
+            tops_.push_back(dull ? cutoff * (50 + Next() % 45) / 100 : cutoff);
+        }
+    }
+
+    int GetFrames() const { return frames_; }
+
+    void GetFrame(int index, int* magnitudes)
+    {
+        const int passageFrames = static_cast<int>(5 * framesPerSecond);
+        const int top = tops_[index / passageFrames];
+        for (int i = 0; i < binCount; ++i) {
+            const int noise = Next() % 64;
+            magnitudes[i] = (i <= top) ? 20000 + noise * 50 : noise;
+        }
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SyntheticTrack);
+
+    unsigned int Next()
+    {
+        seed_ = seed_ * 1103515245 + 12345;
+        return (seed_ >> 8) & 0xffffff;
+    }
+
+    unsigned int seed_;
+    int frames_;
+    vector<int> tops_;
+};
+
+// Mean of the checkpoint cutoffs in Hz over [first, first + count) frames,
+// appended to |freqs|.
+void Analyze(SyntheticTrack* track, CutoffDetector* detector, int first,
+             int count, vector<int>* freqs)
+{
+    vector<int> magnitudes(binCount);
+    detector->Reset(binCount);
+    for (int i = 1; i <= count; ++i) {
+        track->GetFrame(first + i - 1, &magnitudes[0]);
+        detector->Accumulate(&magnitudes[0]);
+        if (i % checkPointInterval)
+            continue;
+
+        const int index = detector->FindCutoffIndex();
+        freqs->push_back((index + 1) * (sampleRate / 2) / (binCount - 1));
+        detector->Reset(binCount);
+    }
+}
+
+int Average(const vector<int>& freqs, int dropped)
+{
+    const int count = static_cast<int>(freqs.size()) - dropped;
+    if (count <= 0)
+        return 0;
+
+    double sum = 0;
+    for (int i = 0; i < count; ++i)
+        sum += freqs[i];
+
+    return static_cast<int>(sum / count);
+}
+}
+
+// How far the cutoff of the sampled mode ends up from the full decode, and
+// how many frames it saves, over tracks of 3 to 70 minutes. There is no set
+// of reference recordings in the tree, so this runs on synthetic spectra.
+TEST(SampledCutoffPerfTest, DISABLED_ErrorAgainstFullDecode)
+{
+    const int trackCount = 40;
+    const int windowCounts[] = {4, 8, 16, 32};
+    const int configCount = arraysize(windowCounts);
+    vector<double> errorSums(configCount, 0);
+    vector<int> errorMaxima(configCount, 0);
+    vector<double> sampledFrames(configCount, 0);
+    double fullFrames = 0;
+    unique_ptr<CutoffDetector> detector(
+        CutoffDetector::Create(CutoffDetector::kMagnitudeRatio));
+    for (int t = 0; t < trackCount; ++t) {
+        const double seconds = 180 + (t * 7919 % trackCount) * 100;
+        const int first = static_cast<int>(headSeconds * framesPerSecond);
+        SyntheticTrack track(t + 1, seconds);
+        vector<int> freqs;
+        Analyze(&track, detector.get(), first, track.GetFrames() - first,
+                &freqs);
+        const int fullCutoff = Average(freqs, tailCheckPoints);
+        fullFrames += track.GetFrames() - first;
+
+        for (int c = 0; c < configCount; ++c) {
+            vector<double> positions;
+            GetWindowPositions(seconds, headSeconds, tailSeconds,
+                               windowCounts[c],
+                               windowFrames / framesPerSecond, &positions);
+            ASSERT_FALSE(positions.empty());
+            freqs.clear();
+            for (auto i = positions.begin(), e = positions.end(); i != e;
+                ++i) {
+                Analyze(&track, detector.get(),
+                        static_cast<int>(*i * framesPerSecond), windowFrames,
+                        &freqs);
+            }
+
+            const int error = abs(Average(freqs, 0) - fullCutoff);
+            errorSums[c] += error;
+            errorMaxima[c] = max(errorMaxima[c], error);
+            sampledFrames[c] += positions.size() * windowFrames;
+        }
+    }
+
+    for (int c = 0; c < configCount; ++c) {
+        printf("%2d windows: mean error %.0f Hz, max %d Hz, %.1f%% of the "
+               "frames\n", windowCounts[c], errorSums[c] / trackCount,
+               errorMaxima[c], 100 * sampledFrames[c] / fullFrames);
+    }
+}
@@ -0,0 +1,179 @@
+#include "scan_session.h"
+
+#include <cassert>
+
+#include <boost/filesystem.hpp>
+
+#include "binary_archive.h"
+#include "identification_pipeline.h"
+#include "preference.h"
+
+using std::wstring;
+using std::shared_ptr;
+using boost::filesystem::path;
+using base::CancellationFlag;
+
+namespace {
+const wchar_t* rejectedFileName = L"rejected.bin";
+}
+
+ScanSession::ScanSession(DirTraversing::Callback* callback,
+                         const wstring& resultDir,
+                         const shared_ptr<CancellationFlag>& cancelFlag,
+                         int shardIndex, int shardCount)
+    : callback_(callback)
+    , cancelFlag_(cancelFlag)
+    , initialized_(false)
+    , persResult_()
+    , pipeline_()
+    , resultDir_(resultDir)
+    , shardIndex_(shardIndex)
+    , shardCount_(shardCount > 0 ? shardCount : 1)
+    , filter_(Preference::GetInstance()->GetAllowedExtensions(),
+              Preference::GetInstance()->GetDeniedExtensions())
+    , rejected_()
+    , rejectedChanged_(false)
+{
+    assert((shardIndex_ >= 0) && (shardIndex_ < shardCount_));
+}
+
+ScanSession::~ScanSession()
+{
+    SaveRejected();
+}
+
+int ScanSession::GetShard(const wstring& key, int shardCount)
+{
+    if (shardCount <= 1)
+        return 0;
+
+    // FNV-1a over UTF-16 code units, unlike std::hash it does not depend on
+    // the build.
+    uint32 hash = 2166136261U;
+    for (auto i = key.begin(), e = key.end(); i != e; ++i) {
+        const uint16 c = static_cast<uint16>(*i);
+        hash = (hash ^ (c & 0xFF)) * 16777619U;
+        hash = (hash ^ (c >> 8)) * 16777619U;
+    }
+
+    return static_cast<int>(hash % static_cast<uint32>(shardCount));
+}
+
+void ScanSession::Initializing(int totalFiles)
+{
+    if (initialized_)
+        return;
+
+    callback_->Initializing(totalFiles);
+    persResult_ = PersistentMap::CreateInstance(resultDir_);
+
+    // Only a cache, the files are sniffed again if it is gone or damaged.
+    if (!BinaryArchive::Read((path(resultDir_) / rejectedFileName).wstring(),
+                             &rejected_))
+        rejected_.clear();
+
+    Preference* pref = Preference::GetInstance();
+    AudioQualityIdent::Options options;
+    options.Detector = pref->GetCutoffDetector();
+    options.SampledWindows = pref->GetSampledWindows();
+    options.WindowFrames = pref->GetWindowFrames();
+    options.ConvergenceTolerance = pref->GetConvergenceTolerance();
+    options.ConvergenceCheckPoints = pref->GetConvergenceCheckPoints();
+    options.Engine = pref->GetSpectrumEngine();
+    options.FftSize = pref->GetFftSize();
+    options.FftOverlap = pref->GetFftOverlap();
+    options.Backend = pref->GetDecoderBackend();
+    options.DecoderLatency = pref->GetDecoderLatency();
+    options.Channels = pref->GetChannelMode();
+    pipeline_.reset(
+        new IdentificationPipeline(
+            persResult_, options, cancelFlag_, pref->GetWorkerCount(),
+            static_cast<int64>(pref->GetPrefetchBudget()) * 1024 * 1024,
+            pref->GetIsolationTimeout(), pref->GetDeduplication()));
+    initialized_ = pipeline_->Start();
+}
+
+void ScanSession::TotalChanged(int totalFiles)
+{
+    callback_->TotalChanged(totalFiles);
+}
+
+bool ScanSession::Progress(const wstring& current, int64 size,
+                           int64 lastModified)
+{
+    if (!initialized_)
+        return false;
+
+    bool rv = callback_->Progress(current, size, lastModified);
+    if (!rv)
+        return rv;
+
+    // Shards go by the file name, which does not depend on where a node has
+    // mounted the archive.
+    if (GetShard(path(current).filename().wstring(), shardCount_) !=
+        shardIndex_)
+        return rv;
+
+    // Unchanged since the last scan.
+    if (persResult_->IsUpToDate(current, size, lastModified))
+        return rv;
+
+    if (!Accept(current, size, lastModified))
+        return rv;
+
+    return pipeline_->Submit(current, current, size, lastModified);
+}
+
+void ScanSession::Done()
+{
+    // Every queued file has to be committed before the progress dialog
+    // goes away.
+    if (pipeline_)
+        pipeline_->Finish();
+
+    callback_->Done();
+}
+
+bool ScanSession::Save()
+{
+    SaveRejected();
+    return initialized_ && persResult_ && persResult_->Save();
+}
+
+bool ScanSession::Accept(const wstring& current, int64 size,
+                         int64 lastModified)
+{
+    const AudioFileFilter::Verdict verdict = filter_.CheckExtension(current);
+    if (verdict != AudioFileFilter::kUnsure)
+        return verdict == AudioFileFilter::kAccepted;
+
+    auto cached = rejected_.find(current);
+    if ((cached != rejected_.end()) && (cached->second.Size == size) &&
+        (cached->second.LastModified == lastModified))
+        return false;
+
+    // A file that cannot be read now may be readable next time.
+    const AudioFileFilter::Verdict sniffed = AudioFileFilter::Sniff(current);
+    if (sniffed == AudioFileFilter::kRejected) {
+        PersistentMap::MediaInfo& info = rejected_[current];
+        info.Size = size;
+        info.LastModified = lastModified;
+        rejectedChanged_ = true;
+    } else if (cached != rejected_.end()) {
+        rejected_.erase(cached);
+        rejectedChanged_ = true;
+    }
+
+    return sniffed == AudioFileFilter::kAccepted;
+}
+
+void ScanSession::SaveRejected()
+{
+    if (!rejectedChanged_)
+        return;
+
+    // Not worth failing the scan for.
+    BinaryArchive::Write((path(resultDir_) / rejectedFileName).wstring(),
+                         rejected_);
+    rejectedChanged_ = false;
+}
@@ -0,0 +1,67 @@
+#ifndef _SCAN_SESSION_H_
+#define _SCAN_SESSION_H_
+
+#include <memory>
+#include <string>
+
+#include "audio_file_filter.h"
+#include "dir_traversing.h"
+#include "persistent_map.h"
+#include "third_party/chromium/base/synchronization/cancellation_flag.h"
+
+//------------------------------------------------------------------------------
+// Feeds the files found by DirTraversing into an IdentificationPipeline set up
+// from the Preference, and passes the progress on to |callback|. With
+// |shardCount| above one, only the files whose name hashes to |shardIndex| are
+// identified, so that several nodes can split one archive between them. Files
+// the AudioFileFilter rejects are neither identified nor stored. A rescan only
+// identifies the files that are new, or differ in size or modification time
+// from what the store recorded. Files rejected by their first bytes are kept
+// in a list of their own next to the store, by size and modification time as
+// well, so that a rescan does not read them again.
+class IdentificationPipeline;
+class ScanSession : public DirTraversing::Callback
+{
+public:
+    ScanSession(DirTraversing::Callback* callback,
+                const std::wstring& resultDir,
+                const std::shared_ptr<base::CancellationFlag>& cancelFlag,
+                int shardIndex, int shardCount);
+    virtual ~ScanSession();
+
+    // The shard of |key| out of |shardCount|. The same on every node.
+    static int GetShard(const std::wstring& key, int shardCount);
+
+    virtual void Initializing(int totalFiles);
+    virtual void TotalChanged(int totalFiles);
+    virtual bool Progress(const std::wstring& current, int64 size,
+                          int64 lastModified);
+    virtual void Done();
+
+    // Writes the store once Done() has committed everything, rather than
+    // when the session ends. Returns false if it cannot be written, or the
+    // session never started, e.g. because a worker failed to initialize.
+    bool Save();
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ScanSession);
+
+    bool Accept(const std::wstring& current, int64 size, int64 lastModified);
+    void SaveRejected();
+
+    DirTraversing::Callback* callback_;
+    std::shared_ptr<base::CancellationFlag> cancelFlag_;
+    bool initialized_;
+    std::shared_ptr<PersistentMap> persResult_;
+    std::unique_ptr<IdentificationPipeline> pipeline_;
+    std::wstring resultDir_;
+    int shardIndex_;
+    int shardCount_;
+    AudioFileFilter filter_;
+
+    // Keyed like the store, only the size and modification time are set.
+    PersistentMap::ContainerType rejected_;
+    bool rejectedChanged_;
+};
+
+#endif  // _SCAN_SESSION_H_
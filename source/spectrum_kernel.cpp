@@ -0,0 +1,127 @@
+#include "spectrum_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <emmintrin.h>
+
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/base/cpu.h"
+
+using std::max;
+
+namespace {
+typedef void (*AccumulatePowerMaxProc)(const int*, int, float*);
+
+const float ln2 = 0.693147181f;
+const float sqrt2 = 1.414213562f;
+
+// ln(m) = 2 * atanh((m - 1) / (m + 1)). With the mantissa folded into
+// [sqrt(0.5), sqrt(2)) the series converges fast enough after four terms.
+const float c1 = 2.0f;
+const float c3 = 2.0f / 3.0f;
+const float c5 = 2.0f / 5.0f;
+const float c7 = 2.0f / 7.0f;
+
+// |x| must not be less than 1.
+inline float FastLn(float x)
+{
+    uint32 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int exponent = static_cast<int>(bits >> 23) - 127;
+    bits = (bits & 0x007fffff) | 0x3f800000;
+
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    if (m > sqrt2) {
+        m -= m * 0.5f;
+        exponent++;
+    }
+
+    const float t = (m - 1.0f) / (m + 1.0f);
+    const float t2 = t * t;
+    const float s = ((c7 * t2 + c5) * t2 + c3) * t2 + c1;
+    return static_cast<float>(exponent) * ln2 + s * t;
+}
+
+void AccumulatePowerMaxScalar(const int* magnitudes, int count, float* power)
+{
+    for (int i = 0; i < count; ++i) {
+        const float x = max(static_cast<float>(magnitudes[i]), 1.0f);
+        power[i] = max(power[i], 10.0f * FastLn(x));
+    }
+}
+
+// Four bins per iteration, same arithmetic as FastLn().
+void AccumulatePowerMaxSse2(const int* magnitudes, int count, float* power)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 ten = _mm_set1_ps(10.0f);
+    const __m128 ln2Lanes = _mm_set1_ps(ln2);
+    const __m128 sqrt2Lanes = _mm_set1_ps(sqrt2);
+    const __m128 c1Lanes = _mm_set1_ps(c1);
+    const __m128 c3Lanes = _mm_set1_ps(c3);
+    const __m128 c5Lanes = _mm_set1_ps(c5);
+    const __m128 c7Lanes = _mm_set1_ps(c7);
+    const __m128i mantissaMask = _mm_set1_epi32(0x007fffff);
+    const __m128i oneBits = _mm_set1_epi32(0x3f800000);
+    const __m128i bias = _mm_set1_epi32(127);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i raw = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(magnitudes + i));
+        const __m128 x = _mm_max_ps(_mm_cvtepi32_ps(raw), one);
+        const __m128i bits = _mm_castps_si128(x);
+        __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), bias);
+        __m128 m = _mm_castsi128_ps(
+            _mm_or_si128(_mm_and_si128(bits, mantissaMask), oneBits));
+
+        // The comparison yields all ones (-1) in the lanes to fold.
+        const __m128 above = _mm_cmpgt_ps(m, sqrt2Lanes);
+        m = _mm_sub_ps(m, _mm_and_ps(above, _mm_mul_ps(m, half)));
+        exponent = _mm_sub_epi32(exponent, _mm_castps_si128(above));
+
+        const __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+        const __m128 t2 = _mm_mul_ps(t, t);
+        __m128 s = _mm_add_ps(_mm_mul_ps(c7Lanes, t2), c5Lanes);
+        s = _mm_add_ps(_mm_mul_ps(s, t2), c3Lanes);
+        s = _mm_add_ps(_mm_mul_ps(s, t2), c1Lanes);
+        const __m128 ln = _mm_add_ps(
+            _mm_mul_ps(_mm_cvtepi32_ps(exponent), ln2Lanes),
+            _mm_mul_ps(s, t));
+
+        const __m128 prev = _mm_loadu_ps(power + i);
+        _mm_storeu_ps(power + i, _mm_max_ps(prev, _mm_mul_ps(ln, ten)));
+    }
+
+    AccumulatePowerMaxScalar(magnitudes + i, count - i, power + i);
+}
+
+AccumulatePowerMaxProc SelectAccumulatePowerMax()
+{
+    base::CPU cpu;
+    if (cpu.has_sse2())
+        return AccumulatePowerMaxSse2;
+
+    return AccumulatePowerMaxScalar;
+}
+
+// Resolved during static initialization, before any worker thread exists.
+const AccumulatePowerMaxProc accumulatePowerMax = SelectAccumulatePowerMax();
+}
+
+void AccumulatePowerMax(const int* magnitudes, int count, float* power)
+{
+    accumulatePowerMax(magnitudes, count, power);
+}
+
+void AccumulatePowerMaxExact(const int* magnitudes, int count, float* power)
+{
+    for (int i = 0; i < count; ++i) {
+        const double d = 10 * log(static_cast<double>(max(magnitudes[i], 1)));
+        power[i] = max(power[i], static_cast<float>(d));
+    }
+}
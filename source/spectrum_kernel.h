@@ -0,0 +1,17 @@
+#ifndef _SPECTRUM_KERNEL_H_
+#define _SPECTRUM_KERNEL_H_
+
+//------------------------------------------------------------------------------
+// Hot loops of the cutoff analysis. The implementation is picked once at start
+// up according to the instruction sets the processor supports.
+
+// Folds one frame of spectrum magnitudes into the running per-bin maximum of
+// 10 * ln(magnitude). Magnitudes below 1 count as 0, so |power| never holds a
+// negative value. Uses a fast logarithm accurate to about 1e-5.
+void AccumulatePowerMax(const int* magnitudes, int count, float* power);
+
+// Same as above with the C runtime log(). Kept as the reference for the
+// approximated kernels.
+void AccumulatePowerMaxExact(const int* magnitudes, int count, float* power);
+
+#endif  // _SPECTRUM_KERNEL_H_
@@ -0,0 +1,43 @@
+#include "spectrum_kernel.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "third_party/chromium/base/time.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::vector;
+
+namespace {
+// One minute of 44.1 kHz audio in 1024 point frames.
+const int binCount = 512;
+const int frameCount = 2584;
+
+typedef void (*AccumulateProc)(const int*, int, float*);
+
+double TimeAccumulate(AccumulateProc accumulate, const vector<int>& frames)
+{
+    vector<float> power(binCount, 0.0f);
+    const base::TimeTicks start = base::TimeTicks::HighResNow();
+    for (int f = 0; f < frameCount; ++f)
+        accumulate(&frames[f * binCount], binCount, &power[0]);
+
+    const base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+    EXPECT_LT(0.0f, power[0]);
+    return elapsed.InMillisecondsF();
+}
+}
+
+TEST(SpectrumKernelPerfTest, DISABLED_AccumulatePowerMax)
+{
+    srand(1);
+    vector<int> frames(binCount * frameCount);
+    for (size_t i = 0; i < frames.size(); ++i)
+        frames[i] = 1 + rand() % 100000;
+
+    const double exact = TimeAccumulate(AccumulatePowerMaxExact, frames);
+    const double fast = TimeAccumulate(AccumulatePowerMax, frames);
+    printf("AccumulatePowerMaxExact: %.2f ms\n", exact);
+    printf("AccumulatePowerMax:      %.2f ms (%.1fx)\n", fast, exact / fast);
+}
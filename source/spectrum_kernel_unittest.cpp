@@ -0,0 +1,121 @@
+#include "spectrum_kernel.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::vector;
+
+namespace {
+const int binCount = 512;
+const int frameCount = 64;
+
+// 10 * ln() of the fast kernel is accurate to about 1e-4.
+const float tolerance = 1e-3f;
+
+// Same scan as the log power detector.
+int FindCutoffIndex(const vector<float>& power)
+{
+    const int amount = static_cast<int>(power.size());
+    float prev = power[amount - 1];
+    for (int i = amount - 2; i >= 0; --i) {
+        if (fabs(prev - power[i]) > 3.0f)
+            return i;
+
+        prev = power[i];
+    }
+
+    return 0;
+}
+
+// Spectrum frames of a track cut off at |cutoff|: loud noise below, faint
+// noise above.
+vector<int> MakeFrames(int cutoff, unsigned int seed)
+{
+    srand(seed);
+    vector<int> frames(binCount * frameCount);
+    for (int f = 0; f < frameCount; ++f) {
+        for (int i = 0; i < binCount; ++i) {
+            const int noise = rand() % 64;
+            frames[f * binCount + i] =
+                (i <= cutoff) ? 20000 + noise * 50 : noise;
+        }
+    }
+
+    return frames;
+}
+}
+
+TEST(SpectrumKernelTest, MatchesExact)
+{
+    vector<int> magnitudes;
+    magnitudes.push_back(-5);
+    magnitudes.push_back(0);
+    magnitudes.push_back(1);
+    magnitudes.push_back(2);
+    magnitudes.push_back(3);
+    for (int i = 0; i < 31; ++i) {
+        magnitudes.push_back((1 << i) - 1);
+        magnitudes.push_back(1 << i);
+        magnitudes.push_back((1 << i) + 1);
+    }
+
+    magnitudes.push_back(0x7fffffff);
+
+    srand(1);
+    for (int i = 0; i < 10000; ++i)
+        magnitudes.push_back((rand() & 0x7fff) << 16 | (rand() & 0xffff));
+
+    // An odd count exercises the scalar tail after the vector loop.
+    const int count = static_cast<int>(magnitudes.size());
+    ASSERT_NE(0, count % 4);
+
+    vector<float> fast(count, 0.0f);
+    vector<float> exact(count, 0.0f);
+    AccumulatePowerMax(&magnitudes[0], count, &fast[0]);
+    AccumulatePowerMaxExact(&magnitudes[0], count, &exact[0]);
+    for (int i = 0; i < count; ++i)
+        EXPECT_NEAR(exact[i], fast[i], tolerance) << magnitudes[i];
+}
+
+TEST(SpectrumKernelTest, FloorsAtZero)
+{
+    const int magnitudes[] = {-100, -1, 0, 1, -7, 0, 1};
+    const int count = arraysize(magnitudes);
+    vector<float> power(count, 0.0f);
+    AccumulatePowerMax(magnitudes, count, &power[0]);
+    for (int i = 0; i < count; ++i)
+        EXPECT_EQ(0.0f, power[i]);
+}
+
+TEST(SpectrumKernelTest, KeepsMaximum)
+{
+    const int loud[] = {1000, 1000, 1000, 1000, 1000};
+    const int quiet[] = {10, 10, 10, 10, 10};
+    const int count = arraysize(loud);
+    vector<float> power(count, 0.0f);
+    AccumulatePowerMax(loud, count, &power[0]);
+    AccumulatePowerMax(quiet, count, &power[0]);
+    for (int i = 0; i < count; ++i)
+        EXPECT_NEAR(10 * log(1000.0), power[i], tolerance);
+}
+
+TEST(SpectrumKernelTest, ReportsSameCutoffsAsExact)
+{
+    for (int cutoff = 1; cutoff < binCount - 1; cutoff += 7) {
+        const vector<int> frames = MakeFrames(cutoff, cutoff);
+        vector<float> fast(binCount, 0.0f);
+        vector<float> exact(binCount, 0.0f);
+        for (int f = 0; f < frameCount; ++f) {
+            AccumulatePowerMax(&frames[f * binCount], binCount, &fast[0]);
+            AccumulatePowerMaxExact(&frames[f * binCount], binCount,
+                                    &exact[0]);
+        }
+
+        EXPECT_EQ(cutoff, FindCutoffIndex(exact));
+        EXPECT_EQ(FindCutoffIndex(exact), FindCutoffIndex(fast));
+    }
+}
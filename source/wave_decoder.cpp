@@ -0,0 +1,294 @@
+#include "wave_decoder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include "pcm_spectrum_engine.h"
+#include "third_party/chromium/base/threading/platform_thread.h"
+#include "third_party/multimedia_core/audio_sample_extracter_interface.h"
+#include "third_party/multimedia_core/audio_spectrum_extracter_interface.h"
+
+using std::vector;
+using std::min;
+using std::max;
+
+namespace {
+const int waveFormatPcm = 1;
+const int waveFormatExtensible = 0xFFFE;
+
+// All the chunks in front of "data" have to fit in here.
+const int64 headerProbeSize = 1024 * 1024;
+
+// Sample data is read in segments of about this size, and every segment is
+// delivered in blocks of at least |minBlockFrames|.
+const int64 segmentSize = 4 * 1024 * 1024;
+const int minBlockFrames = 4096;
+
+uint32 ReadLe16(const int8* p)
+{
+    const uint8* b = reinterpret_cast<const uint8*>(p);
+    return b[0] | (b[1] << 8);
+}
+
+uint32 ReadLe32(const int8* p)
+{
+    const uint8* b = reinterpret_cast<const uint8*>(p);
+    return b[0] | (b[1] << 8) | (b[2] << 16) |
+        (static_cast<uint32>(b[3]) << 24);
+}
+
+// Keeps the 16 most significant bits of a little-endian sample.
+int16 ToInt16(const int8* p, int bytes)
+{
+    if (bytes == 1)
+        return static_cast<int16>((static_cast<uint8>(p[0]) - 128) << 8);
+
+    return static_cast<int16>(ReadLe16(p + bytes - 2));
+}
+
+class PcmSample : public kugou::CUnknown, public IAudioSample
+{
+public:
+    PcmSample()
+        : kugou::CUnknown(NULL, NULL)
+        , channels_(0)
+        , sampleRate_(0)
+        , sampleCount_(0)
+        , samples_()
+    {
+    }
+
+    DELEGATE_IUNKNOWN;
+    virtual void __stdcall Init(int32 bitsPerSample, int32 channels,
+                                int32 samples, int32 sampleRate)
+    {
+        assert(bitsPerSample == 16);
+        channels_ = channels;
+        sampleRate_ = sampleRate;
+        sampleCount_ = samples;
+        samples_.resize(samples * channels);
+    }
+    virtual void __stdcall SetAvailableSamples(int32 samples)
+    {
+        sampleCount_ = samples;
+    }
+    virtual int __stdcall GetBitsPerSample() const { return 16; }
+    virtual int __stdcall GetChannels() const { return channels_; }
+    virtual int __stdcall GetSampleRate() const { return sampleRate_; }
+    virtual int __stdcall GetSampleCount() const { return sampleCount_; }
+    virtual void* __stdcall GetSamples() const
+    {
+        return samples_.empty() ? NULL : const_cast<int16*>(&samples_[0]);
+    }
+
+private:
+    int channels_;
+    int sampleRate_;
+    int sampleCount_;
+    vector<int16> samples_;
+};
+}
+
+bool ParseWaveHeader(const int8* data, int64 length, WaveFormat* format)
+{
+    assert(format);
+    if (!data || (length < 12) || memcmp(data, "RIFF", 4) ||
+        memcmp(data + 8, "WAVE", 4))
+        return false;
+
+    bool formatFound = false;
+    int64 pos = 12;
+    while (pos + 8 <= length) {
+        const int8* chunk = data + pos;
+        const int64 chunkSize = ReadLe32(chunk + 4);
+        if (!memcmp(chunk, "fmt ", 4)) {
+            if ((chunkSize < 16) || (pos + 8 + 16 > length))
+                return false;
+
+            int formatTag = ReadLe16(chunk + 8);
+            if ((formatTag == waveFormatExtensible) && (chunkSize >= 40) &&
+                (pos + 8 + 40 <= length))
+                formatTag = ReadLe16(chunk + 8 + 24);
+
+            if (formatTag != waveFormatPcm)
+                return false;
+
+            format->Channels = ReadLe16(chunk + 10);
+            format->SampleRate = ReadLe32(chunk + 12);
+            format->BitsPerSample = ReadLe16(chunk + 22);
+            formatFound = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            format->DataOffset = pos + 8;
+            format->DataSize = chunkSize;
+            break;
+        }
+
+        // Chunks are padded to an even size.
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    if (!formatFound || !format->DataOffset)
+        return false;
+
+    const int bits = format->BitsPerSample;
+    return (format->Channels > 0) && (format->SampleRate > 0) &&
+        (bits >= 8) && (bits <= 32) && !(bits % 8);
+}
+
+//------------------------------------------------------------------------------
+WaveExtracter::WaveExtracter(int latency)
+    : kugou::CUnknown(NULL, NULL)
+    , latency_(latency)
+    , file_()
+    , format_()
+    , position_(0)
+    , segment_()
+    , sample_(new PcmSample())
+    , engine_()
+{
+}
+
+WaveExtracter::~WaveExtracter()
+{
+}
+
+bool WaveExtracter::Open(const wchar_t* filePath)
+{
+    file_.Close();
+    format_ = WaveFormat();
+    position_ = 0;
+    if (!filePath || !file_.Open(filePath))
+        return false;
+
+    vector<int8> header(static_cast<size_t>(
+        min(file_.GetSize(), headerProbeSize)));
+    if (header.empty() ||
+        !file_.Read(0, static_cast<int64>(header.size()), &header[0]) ||
+        !ParseWaveHeader(&header[0], static_cast<int64>(header.size()),
+                         &format_)) {
+        file_.Close();
+        return false;
+    }
+
+    // Streaming writers leave the size open, trust the file instead.
+    const int64 available = file_.GetSize() - format_.DataOffset;
+    if (!format_.DataSize || (format_.DataSize > available))
+        format_.DataSize = max<int64>(available, 0);
+
+    return true;
+}
+
+bool WaveExtracter::Seek(double seconds)
+{
+    if (!file_.IsValid() || (seconds < 0.0))
+        return false;
+
+    const int64 frame = static_cast<int64>(seconds * format_.SampleRate);
+    if (frame >= GetFrameCount())
+        return false;
+
+    position_ = frame;
+    return true;
+}
+
+void WaveExtracter::ExtractFormat(int32* bitsPerSample, int32* channels,
+                                  int32* sampleRate, int64* sampleCount,
+                                  int32* bitRate)
+{
+    if (bitsPerSample)
+        *bitsPerSample = format_.BitsPerSample;
+
+    if (channels)
+        *channels = format_.Channels;
+
+    if (sampleRate)
+        *sampleRate = format_.SampleRate;
+
+    if (sampleCount)
+        *sampleCount = GetFrameCount();
+
+    if (bitRate)
+        *bitRate =
+            format_.SampleRate * format_.Channels * format_.BitsPerSample;
+}
+
+bool WaveExtracter::ExtractResampled(int32 bitsPerSample, int32 channels,
+                                     int32 sampleRate, bool signedSample,
+                                     IAudioSampleReceiver* receiver)
+{
+    if (!file_.IsValid() || !receiver || (bitsPerSample != 16) ||
+        !signedSample || (channels != format_.Channels) ||
+        (sampleRate != format_.SampleRate))
+        return false;
+
+    const int bytesPerSample = format_.BitsPerSample / 8;
+    const int frameBytes = bytesPerSample * channels;
+    const int align = max(receiver->GetBlockAlign(sampleRate), 1);
+    const int blockFrames = (minBlockFrames + align - 1) / align * align;
+    const int64 segmentFrames =
+        max<int64>(segmentSize / frameBytes / blockFrames, 1) * blockFrames;
+
+    sample_->Init(16, channels, blockFrames, sampleRate);
+    int16* out = static_cast<int16*>(sample_->GetSamples());
+
+    const int64 frameCount = GetFrameCount();
+    while (position_ < frameCount) {
+        const int64 frames = min(segmentFrames, frameCount - position_);
+        segment_.resize(static_cast<size_t>(frames * frameBytes));
+        if (!file_.Read(format_.DataOffset + position_ * frameBytes,
+                        frames * frameBytes, &segment_[0]))
+            return false;
+
+        const int8* in = &segment_[0];
+        for (int64 done = 0; done < frames; done += blockFrames) {
+            const int count =
+                static_cast<int>(min<int64>(blockFrames, frames - done));
+            for (int i = 0; i < count * channels; ++i)
+                out[i] = ToInt16(in + i * bytesPerSample, bytesPerSample);
+
+            in += count * frameBytes;
+            sample_->SetAvailableSamples(count);
+            if (!receiver->Receive(sample_.get())) {
+                position_ += done + count;
+                return true;
+            }
+        }
+
+        position_ += frames;
+        if (latency_ > 0)
+            base::PlatformThread::Sleep(
+                static_cast<int>(latency_ * frames / sampleRate));
+    }
+
+    return true;
+}
+
+bool WaveExtracter::ExtractSpectrum(const int32* channelIndexes,
+                                    int32 channelCount, int32 windowSize,
+                                    IAudioSpectrumReceiver** receivers)
+{
+    if (!channelIndexes || (channelCount <= 0) || !receivers ||
+        (windowSize < 4) || (windowSize & (windowSize - 1)))
+        return false;
+
+    for (int i = 0; i < channelCount; ++i) {
+        if ((channelIndexes[i] < 0) ||
+            (channelIndexes[i] >= format_.Channels))
+            return false;
+    }
+
+    if (!engine_ || (engine_->GetFftSize() != windowSize))
+        engine_ = new PcmSpectrumEngine(windowSize, 0);
+
+    engine_->Start(channelIndexes, channelCount, receivers);
+    return ExtractResampled(16, format_.Channels, format_.SampleRate, true,
+                            engine_.get());
+}
+
+int64 WaveExtracter::GetFrameCount() const
+{
+    const int64 frameBytes = format_.BitsPerSample / 8 * format_.Channels;
+    return frameBytes ? format_.DataSize / frameBytes : 0;
+}
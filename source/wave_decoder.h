@@ -0,0 +1,84 @@
+#ifndef _WAVE_DECODER_H_
+#define _WAVE_DECODER_H_
+
+#include <vector>
+
+#include "mapped_file.h"
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/base/memory/ref_counted.h"
+#include "third_party/multimedia_core/audio_information_extracter_interface.h"
+#include "third_party/multimedia_core/common/unknown_impl.h"
+
+//------------------------------------------------------------------------------
+struct WaveFormat
+{
+    WaveFormat()
+        : BitsPerSample(0)
+        , Channels(0)
+        , SampleRate(0)
+        , DataOffset(0)
+        , DataSize(0)
+    {
+    }
+
+    int BitsPerSample;
+    int Channels;
+    int SampleRate;
+
+    // Position and length of the "data" chunk, as declared by the header.
+    int64 DataOffset;
+    int64 DataSize;
+};
+
+// Reads the RIFF header of an integer PCM wave file from the first |length|
+// bytes of |data|. The sample data itself need not be part of the buffer.
+bool ParseWaveHeader(const int8* data, int64 length, WaveFormat* format);
+
+//------------------------------------------------------------------------------
+struct IAudioSample;
+class PcmSpectrumEngine;
+
+// A built-in IAudioInformationExtracter for PCM wave files, so that the
+// identification can run without the multimedia core. Samples are handed out
+// in the file's own rate and channel layout only, there is no resampler. The
+// spectrum is computed by PcmSpectrumEngine.
+class WaveExtracter : public kugou::CUnknown, public IAudioInformationExtracter
+{
+public:
+    // Every second of audio handed out costs |latency| extra milliseconds,
+    // which stands in for the decoding time of compressed formats.
+    explicit WaveExtracter(int latency);
+    virtual ~WaveExtracter();
+
+    DELEGATE_IUNKNOWN;
+    virtual bool __stdcall Open(const wchar_t* filePath);
+    virtual bool __stdcall Seek(double seconds);
+    virtual void __stdcall ExtractFormat(int32* bitsPerSample, int32* channels,
+                                         int32* sampleRate, int64* sampleCount,
+                                         int32* bitRate);
+    virtual bool __stdcall ExtractResampled(int32 bitsPerSample,
+                                            int32 channels, int32 sampleRate,
+                                            bool signedSample,
+                                            IAudioSampleReceiver* receiver);
+    virtual bool __stdcall ExtractSpectrum(const int32* channelIndexes,
+                                           int32 channelCount,
+                                           int32 windowSize,
+                                           IAudioSpectrumReceiver** receivers);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(WaveExtracter);
+
+    int64 GetFrameCount() const;
+
+    int latency_;
+    MappedFile file_;
+    WaveFormat format_;
+    int64 position_;
+
+    // Reused by every extraction.
+    std::vector<int8> segment_;
+    scoped_refptr<IAudioSample> sample_;
+    scoped_refptr<PcmSpectrumEngine> engine_;
+};
+
+#endif  // _WAVE_DECODER_H_
@@ -0,0 +1,16 @@
+#include "window_positions.h"
+
+void GetWindowPositions(double durationSeconds, double headSeconds,
+                        double tailSeconds, int windows, double windowSeconds,
+                        std::vector<double>* positions)
+{
+    positions->clear();
+    const double span = durationSeconds - headSeconds - tailSeconds;
+    if ((windows <= 0) || (span < windows * windowSeconds))
+        return;
+
+    const double stride = span / windows;
+    for (int i = 0; i < windows; ++i)
+        positions->push_back(
+            headSeconds + i * stride + (stride - windowSeconds) / 2);
+}
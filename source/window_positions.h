@@ -0,0 +1,16 @@
+#ifndef _WINDOW_POSITIONS_H_
+#define _WINDOW_POSITIONS_H_
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Start positions, in seconds, of |windows| analysis windows of
+// |windowSeconds| each, spread evenly over the track between its first
+// |headSeconds| and its last |tailSeconds|. Each window sits in the middle of
+// its share of that span. Empty if the span is too short to hold the windows
+// without overlapping.
+void GetWindowPositions(double durationSeconds, double headSeconds,
+                        double tailSeconds, int windows, double windowSeconds,
+                        std::vector<double>* positions);
+
+#endif  // _WINDOW_POSITIONS_H_
@@ -0,0 +1,48 @@
+#include "window_positions.h"
+
+#include <vector>
+
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using std::vector;
+
+TEST(WindowPositionsTest, SpreadsEvenly)
+{
+    // 120 s between the head and the tail, four strides of 30 s.
+    vector<double> positions;
+    GetWindowPositions(140.0, 10.0, 10.0, 4, 5.0, &positions);
+    ASSERT_EQ(4u, positions.size());
+    EXPECT_DOUBLE_EQ(22.5, positions[0]);
+    EXPECT_DOUBLE_EQ(52.5, positions[1]);
+    EXPECT_DOUBLE_EQ(82.5, positions[2]);
+    EXPECT_DOUBLE_EQ(112.5, positions[3]);
+}
+
+TEST(WindowPositionsTest, StaysWithinSpan)
+{
+    vector<double> positions;
+    for (int windows = 1; windows <= 32; ++windows) {
+        GetWindowPositions(4200.0, 10.0, 10.0, windows, 4.6, &positions);
+        ASSERT_EQ(static_cast<size_t>(windows), positions.size());
+        EXPECT_LE(10.0, positions.front());
+        EXPECT_GE(4190.0, positions.back() + 4.6);
+        for (int i = 1; i < windows; ++i)
+            EXPECT_LE(positions[i - 1] + 4.6, positions[i]);
+    }
+}
+
+TEST(WindowPositionsTest, TooShort)
+{
+    vector<double> positions(3, 1.0);
+    GetWindowPositions(40.0, 10.0, 10.0, 4, 5.5, &positions);
+    EXPECT_TRUE(positions.empty());
+
+    // Exactly filled, the windows touch.
+    GetWindowPositions(40.0, 10.0, 10.0, 4, 5.0, &positions);
+    ASSERT_EQ(4u, positions.size());
+    EXPECT_DOUBLE_EQ(10.0, positions[0]);
+    EXPECT_DOUBLE_EQ(25.0, positions[3]);
+
+    GetWindowPositions(40.0, 10.0, 10.0, 0, 5.0, &positions);
+    EXPECT_TRUE(positions.empty());
+}
@@ -0,0 +1,191 @@
+#ifndef _WORK_STEALING_QUEUE_H_
+#define _WORK_STEALING_QUEUE_H_
+
+#include <cassert>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/base/synchronization/condition_variable.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+
+//------------------------------------------------------------------------------
+// Distributes items of very different cost over a fixed set of consumers.
+// Every consumer owns a lane that is kept ordered by cost, and always takes
+// its costliest item first. A consumer whose lane runs dry steals the costliest
+// item of the most loaded other lane. Producers put every item into the lane
+// with the least pending cost, and are held back once |capacity| items are
+// pending. Large items thus start early and the tail of a batch is short.
+template <typename T>
+class WorkStealingQueue
+{
+public:
+    WorkStealingQueue(int lanes, size_t capacity)
+        : lanes_()
+        , lock_()
+        , notEmpty_(&lock_)
+        , notFull_(&lock_)
+        , pending_(0)
+        , available_(0)
+        , capacity_(capacity > 0 ? capacity : 1)
+        , closed_(false)
+    {
+        for (int i = 0; i < (lanes > 0 ? lanes : 1); ++i)
+            lanes_.push_back(std::shared_ptr<Lane>(new Lane()));
+    }
+
+    // Blocks while the queue is full. Returns false if the queue has been
+    // closed, in which case the item is dropped.
+    bool Push(const T& item, int64 cost)
+    {
+        {
+            base::AutoLock lock(lock_);
+            while (!closed_ && (pending_ >= capacity_))
+                notFull_.Wait();
+
+            if (closed_)
+                return false;
+
+            pending_++;
+        }
+
+        // Every item counts, even an empty file.
+        const int64 weight = (cost > 0 ? cost : 0) + 1;
+        Lane* target = NULL;
+        int64 lowest = 0;
+        for (auto i = lanes_.begin(), e = lanes_.end(); i != e; ++i) {
+            const int64 laneCost = (*i)->GetPendingCost();
+            if (!target || (laneCost < lowest)) {
+                target = i->get();
+                lowest = laneCost;
+            }
+        }
+
+        target->Insert(item, weight);
+
+        base::AutoLock lock(lock_);
+        available_++;
+        notEmpty_.Signal();
+        return true;
+    }
+
+    // Blocks while no lane has an item. Returns false only after the queue is
+    // closed and every pending item has been handed out.
+    bool Pop(int lane, T* item)
+    {
+        assert((lane >= 0) && (lane < static_cast<int>(lanes_.size())));
+        for (;;) {
+            if (lanes_[lane]->TakeCostliest(item) || Steal(lane, item)) {
+                base::AutoLock lock(lock_);
+                available_--;
+                pending_--;
+                notFull_.Signal();
+                return true;
+            }
+
+            // |available_| may still count an item another consumer has just
+            // taken, in which case the lanes are simply searched again.
+            base::AutoLock lock(lock_);
+            while (!available_ && !(closed_ && !pending_))
+                notEmpty_.Wait();
+
+            if (closed_ && !pending_)
+                return false;
+        }
+    }
+
+    // No more items will be accepted. Consumers still drain what is left.
+    void Close()
+    {
+        base::AutoLock lock(lock_);
+        closed_ = true;
+        notEmpty_.Broadcast();
+        notFull_.Broadcast();
+    }
+
+private:
+    class Lane
+    {
+    public:
+        Lane() : lock_(), items_(), pendingCost_(0) {}
+
+        int64 GetPendingCost()
+        {
+            base::AutoLock lock(lock_);
+            return pendingCost_;
+        }
+
+        // Keeps the lane sorted by ascending cost, the costliest at the back.
+        void Insert(const T& item, int64 cost)
+        {
+            base::AutoLock lock(lock_);
+            auto i = items_.end();
+            while ((i != items_.begin()) && ((i - 1)->first > cost))
+                --i;
+
+            items_.insert(i, std::make_pair(cost, item));
+            pendingCost_ += cost;
+        }
+
+        bool TakeCostliest(T* item)
+        {
+            base::AutoLock lock(lock_);
+            if (items_.empty())
+                return false;
+
+            *item = items_.back().second;
+            pendingCost_ -= items_.back().first;
+            items_.pop_back();
+            return true;
+        }
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(Lane);
+
+        base::Lock lock_;
+        std::deque<std::pair<int64, T>> items_;
+        int64 pendingCost_;
+    };
+
+    DISALLOW_COPY_AND_ASSIGN(WorkStealingQueue);
+
+    bool Steal(int thief, T* item)
+    {
+        for (;;) {
+            Lane* victim = NULL;
+            int64 highest = 0;
+            for (int i = 0; i < static_cast<int>(lanes_.size()); ++i) {
+                if (i == thief)
+                    continue;
+
+                const int64 cost = lanes_[i]->GetPendingCost();
+                if (cost > highest) {
+                    victim = lanes_[i].get();
+                    highest = cost;
+                }
+            }
+
+            if (!victim)
+                return false;
+
+            // The victim may have been drained in the meantime.
+            if (victim->TakeCostliest(item))
+                return true;
+        }
+    }
+
+    std::vector<std::shared_ptr<Lane>> lanes_;
+    base::Lock lock_;
+    base::ConditionVariable notEmpty_;
+    base::ConditionVariable notFull_;
+
+    // Items pushed but not yet handed out, and the part of them that has
+    // already been inserted into a lane.
+    size_t pending_;
+    size_t available_;
+    size_t capacity_;
+    bool closed_;
+};
+
+#endif  // _WORK_STEALING_QUEUE_H_
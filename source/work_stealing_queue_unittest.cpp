@@ -0,0 +1,148 @@
+#include "work_stealing_queue.h"
+
+#include <memory>
+#include <vector>
+
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/threading/simple_thread.h"
+#include "third_party/chromium/testing/gtest/include/gtest/gtest.h"
+
+using base::AutoLock;
+using base::DelegateSimpleThread;
+using base::Lock;
+using std::shared_ptr;
+using std::vector;
+
+namespace {
+// Pops from its lane until the queue is closed and drained, counting what
+// it receives.
+class Consumer : public DelegateSimpleThread::Delegate
+{
+public:
+    Consumer(WorkStealingQueue<int>* queue, int lane, vector<int>* seen,
+             Lock* seenLock)
+        : queue_(queue)
+        , lane_(lane)
+        , seen_(seen)
+        , seenLock_(seenLock)
+    {
+    }
+
+    virtual void Run()
+    {
+        int item;
+        while (queue_->Pop(lane_, &item)) {
+            AutoLock lock(*seenLock_);
+            (*seen_)[item]++;
+        }
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Consumer);
+
+    WorkStealingQueue<int>* queue_;
+    int lane_;
+    vector<int>* seen_;
+    Lock* seenLock_;
+};
+}
+
+TEST(WorkStealingQueueTest, PopsCostliestFirst)
+{
+    WorkStealingQueue<int> queue(1, 16);
+    const int costs[] = {5, 100, 1, 50, 0, 75};
+    for (size_t i = 0; i < arraysize(costs); ++i)
+        ASSERT_TRUE(queue.Push(costs[i], costs[i]));
+
+    const int expected[] = {100, 75, 50, 5, 1, 0};
+    for (size_t i = 0; i < arraysize(expected); ++i) {
+        int item = -1;
+        ASSERT_TRUE(queue.Pop(0, &item));
+        EXPECT_EQ(expected[i], item);
+    }
+}
+
+TEST(WorkStealingQueueTest, PushesToLeastLoadedLane)
+{
+    WorkStealingQueue<int> queue(2, 16);
+
+    // 100 lands in lane 0, the rest in lane 1, which stays cheaper.
+    ASSERT_TRUE(queue.Push(100, 100));
+    ASSERT_TRUE(queue.Push(10, 10));
+    ASSERT_TRUE(queue.Push(20, 20));
+
+    int item = -1;
+    ASSERT_TRUE(queue.Pop(1, &item));
+    EXPECT_EQ(20, item);
+    ASSERT_TRUE(queue.Pop(0, &item));
+    EXPECT_EQ(100, item);
+    ASSERT_TRUE(queue.Pop(1, &item));
+    EXPECT_EQ(10, item);
+}
+
+TEST(WorkStealingQueueTest, StealsFromMostLoadedLane)
+{
+    WorkStealingQueue<int> queue(3, 16);
+    ASSERT_TRUE(queue.Push(100, 100));
+    ASSERT_TRUE(queue.Push(50, 50));
+    ASSERT_TRUE(queue.Push(1, 1));
+
+    // Lane 2 takes its own item, then steals the costliest of lane 0, then
+    // of lane 1.
+    int item = -1;
+    ASSERT_TRUE(queue.Pop(2, &item));
+    EXPECT_EQ(1, item);
+    ASSERT_TRUE(queue.Pop(2, &item));
+    EXPECT_EQ(100, item);
+    ASSERT_TRUE(queue.Pop(2, &item));
+    EXPECT_EQ(50, item);
+}
+
+TEST(WorkStealingQueueTest, CloseDrainsPendingItems)
+{
+    WorkStealingQueue<int> queue(2, 16);
+    ASSERT_TRUE(queue.Push(1, 1));
+    ASSERT_TRUE(queue.Push(2, 2));
+    queue.Close();
+    EXPECT_FALSE(queue.Push(3, 3));
+
+    // Lane 0 holds 1, lane 1 holds 2.
+    int item = -1;
+    ASSERT_TRUE(queue.Pop(0, &item));
+    EXPECT_EQ(1, item);
+    ASSERT_TRUE(queue.Pop(0, &item));
+    EXPECT_EQ(2, item);
+    EXPECT_FALSE(queue.Pop(0, &item));
+    EXPECT_FALSE(queue.Pop(1, &item));
+}
+
+// A capacity far below the item count makes the producer block on full
+// lanes while the consumers steal from each other.
+TEST(WorkStealingQueueTest, HandsOutEveryItemOnce)
+{
+    const int laneCount = 4;
+    const int itemCount = 10000;
+    WorkStealingQueue<int> queue(laneCount, 8);
+    vector<int> seen(itemCount, 0);
+    Lock seenLock;
+
+    vector<shared_ptr<Consumer>> consumers;
+    vector<shared_ptr<DelegateSimpleThread>> threads;
+    for (int i = 0; i < laneCount; ++i) {
+        consumers.push_back(shared_ptr<Consumer>(
+            new Consumer(&queue, i, &seen, &seenLock)));
+        threads.push_back(shared_ptr<DelegateSimpleThread>(
+            new DelegateSimpleThread(consumers.back().get(), "Consumer")));
+        threads.back()->Start();
+    }
+
+    for (int i = 0; i < itemCount; ++i)
+        ASSERT_TRUE(queue.Push(i, (i * 7919) % 1000));
+
+    queue.Close();
+    for (auto i = threads.begin(), e = threads.end(); i != e; ++i)
+        (*i)->Join();
+
+    for (int i = 0; i < itemCount; ++i)
+        EXPECT_EQ(1, seen[i]) << "item " << i;
+}
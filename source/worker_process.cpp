@@ -0,0 +1,472 @@
+#include "worker_process.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <windows.h>
+
+#include "third_party/chromium/base/command_line.h"
+#include "third_party/chromium/base/file_path.h"
+#include "third_party/chromium/base/lazy_instance.h"
+#include "third_party/chromium/base/pickle.h"
+#include "third_party/chromium/base/process_util.h"
+#include "third_party/chromium/base/string_number_conversions.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/time.h"
+
+using std::wstring;
+using std::vector;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::min;
+using base::AutoLock;
+using base::CancellationFlag;
+using base::TimeDelta;
+using base::TimeTicks;
+
+namespace {
+const char jobPipeSwitch[] = "job-pipe";
+const char resultPipeSwitch[] = "result-pipe";
+
+// Seconds a child may take to load its decoders.
+const int startupTimeout = 30;
+
+// Milliseconds between two looks at the cancellation flag while waiting for
+// a result. A result, or the end of the child, ends the wait at once.
+const int cancelCheckInterval = 200;
+
+// Room for a result in the pipe, they are far smaller.
+const int resultPipeBufferSize = 4096;
+
+// Milliseconds a child gets to exit on its own once its pipe is closed.
+const int exitTimeout = 5000;
+
+const int killedExitCode = 1;
+
+// Children are created one at a time, see WorkerProcess::Launch().
+base::LazyInstance<base::Lock> launchLock(base::LINKER_INITIALIZED);
+
+// Makes the result pipe names unique within the process. Guarded by
+// |launchLock|.
+int64 pipeCount = 0;
+
+std::string HandleToString(HANDLE handle)
+{
+    return base::Int64ToString(reinterpret_cast<intptr_t>(handle));
+}
+
+HANDLE GetHandleSwitch(const CommandLine& commandLine, const char* name)
+{
+    int64 value = 0;
+    if (!base::StringToInt64(commandLine.GetSwitchValueASCII(name), &value))
+        return NULL;
+
+    return reinterpret_cast<HANDLE>(static_cast<intptr_t>(value));
+}
+
+// Every message is its size followed by the pickle.
+bool WriteMessage(HANDLE pipe, const Pickle& message)
+{
+    const uint32 size = static_cast<uint32>(message.size());
+    DWORD written = 0;
+    return WriteFile(pipe, &size, sizeof(size), &written, NULL) &&
+        (written == sizeof(size)) &&
+        WriteFile(pipe, message.data(), size, &written, NULL) &&
+        (written == size);
+}
+
+bool ReadFully(HANDLE pipe, char* buf, uint32 size)
+{
+    while (size) {
+        DWORD read = 0;
+        if (!ReadFile(pipe, buf, size, &read, NULL) || !read)
+            return false;
+
+        buf += read;
+        size -= read;
+    }
+
+    return true;
+}
+
+bool ReadMessage(HANDLE pipe, vector<char>* buf)
+{
+    uint32 size = 0;
+    if (!ReadFully(pipe, reinterpret_cast<char*>(&size), sizeof(size)) ||
+        !size)
+        return false;
+
+    buf->resize(size);
+    return ReadFully(pipe, &(*buf)[0], size);
+}
+
+void WriteOptions(const AudioQualityIdent::Options& options, Pickle* message)
+{
+    message->WriteInt(options.Detector);
+    message->WriteInt(options.SampledWindows);
+    message->WriteInt(options.WindowFrames);
+    message->WriteInt(options.ConvergenceTolerance);
+    message->WriteInt(options.ConvergenceCheckPoints);
+    message->WriteInt(options.Engine);
+    message->WriteInt(options.FftSize);
+    message->WriteInt(options.FftOverlap);
+    message->WriteInt(options.Backend);
+    message->WriteInt(options.DecoderLatency);
+    message->WriteInt(options.Channels);
+}
+
+bool ReadOptions(const Pickle& message, AudioQualityIdent::Options* options)
+{
+    void* iter = NULL;
+    int detector;
+    int engine;
+    int backend;
+    int channels;
+    if (!message.ReadInt(&iter, &detector) ||
+        !message.ReadInt(&iter, &options->SampledWindows) ||
+        !message.ReadInt(&iter, &options->WindowFrames) ||
+        !message.ReadInt(&iter, &options->ConvergenceTolerance) ||
+        !message.ReadInt(&iter, &options->ConvergenceCheckPoints) ||
+        !message.ReadInt(&iter, &engine) ||
+        !message.ReadInt(&iter, &options->FftSize) ||
+        !message.ReadInt(&iter, &options->FftOverlap) ||
+        !message.ReadInt(&iter, &backend) ||
+        !message.ReadInt(&iter, &options->DecoderLatency) ||
+        !message.ReadInt(&iter, &channels))
+        return false;
+
+    options->Detector = static_cast<CutoffDetector::Type>(detector);
+    options->Engine = static_cast<IdentificationModes::SpectrumEngine>(engine);
+    options->Backend = static_cast<DecoderBackend::Type>(backend);
+    options->Channels = static_cast<IdentificationModes::ChannelMode>(channels);
+    return true;
+}
+
+void WriteMediaInfo(const PersistentMap::MediaInfo& info, Pickle* message)
+{
+    message->WriteInt(info.SampleRate);
+    message->WriteInt(info.Bitrate);
+    message->WriteInt(info.Channels);
+    message->WriteInt(info.CutoffFreq);
+    message->WriteInt64(info.Duration);
+    message->WriteWString(info.Format);
+}
+
+bool ReadMediaInfo(const Pickle& message, void** iter,
+                   PersistentMap::MediaInfo* info)
+{
+    return message.ReadInt(iter, &info->SampleRate) &&
+        message.ReadInt(iter, &info->Bitrate) &&
+        message.ReadInt(iter, &info->Channels) &&
+        message.ReadInt(iter, &info->CutoffFreq) &&
+        message.ReadInt64(iter, &info->Duration) &&
+        message.ReadWString(iter, &info->Format);
+}
+}
+
+//------------------------------------------------------------------------------
+const char WorkerProcess::identifyWorkerSwitch[] = "identify-worker";
+
+WorkerProcess::WorkerProcess(const AudioQualityIdent::Options& options,
+                             int timeout,
+                             const shared_ptr<CancellationFlag>& cancelFlag)
+    : options_(options)
+    , timeout_(timeout)
+    , cancelFlag_(cancelFlag)
+    , process_(base::kNullProcessHandle)
+    , jobPipe_(NULL)
+    , resultPipe_(NULL)
+    , readEvent_(NULL)
+    , buf_()
+{
+}
+
+WorkerProcess::~WorkerProcess()
+{
+    // The child exits once its pipe is closed.
+    if (jobPipe_) {
+        CloseHandle(jobPipe_);
+        jobPipe_ = NULL;
+    }
+
+    if (process_)
+        base::WaitForSingleProcess(process_, exitTimeout);
+
+    Kill();
+}
+
+bool WorkerProcess::Start()
+{
+    assert(!process_);
+    if (!Launch())
+        return false;
+
+    Pickle options;
+    WriteOptions(options_, &options);
+    if (WriteMessage(jobPipe_, options) && Receive(startupTimeout)) {
+        Pickle ready(&buf_[0], static_cast<int>(buf_.size()));
+        void* iter = NULL;
+        bool initialized = false;
+        if (ready.ReadBool(&iter, &initialized) && initialized)
+            return true;
+    }
+
+    Kill();
+    return false;
+}
+
+bool WorkerProcess::Identify(const wstring& fullPathName,
+                             PersistentMap::MediaInfo* info)
+{
+    if (!process_ && !Start())
+        return false;
+
+    Pickle job;
+    job.WriteWString(fullPathName);
+    if (WriteMessage(jobPipe_, job) && Receive(timeout_)) {
+        Pickle result(&buf_[0], static_cast<int>(buf_.size()));
+        void* iter = NULL;
+        bool identified = false;
+        if (result.ReadBool(&iter, &identified) &&
+            (!identified || ReadMediaInfo(result, &iter, info)))
+            return identified;
+    }
+
+    // Crashed, hung or cancelled. Either way the child is of no more use.
+    Kill();
+    if (cancelFlag_ && cancelFlag_->IsSet())
+        return false;
+
+    *info = PersistentMap::MediaInfo(0, 0, 0, 0, 0, wstring(L"[Crash]"));
+    return true;
+}
+
+int WorkerProcess::RunChild(const CommandLine& commandLine)
+{
+    HANDLE jobPipe = GetHandleSwitch(commandLine, jobPipeSwitch);
+    HANDLE resultPipe = GetHandleSwitch(commandLine, resultPipeSwitch);
+    if (!jobPipe || !resultPipe)
+        return 1;
+
+    vector<char> buf;
+    AudioQualityIdent::Options options;
+    if (!ReadMessage(jobPipe, &buf) ||
+        !ReadOptions(Pickle(&buf[0], static_cast<int>(buf.size())),
+                     &options))
+        return 1;
+
+    // Cancellation is the parent's business, it kills the child.
+    AudioQualityIdent ident(options, shared_ptr<CancellationFlag>());
+    Pickle ready;
+    ready.WriteBool(ident.Init());
+    if (!WriteMessage(resultPipe, ready))
+        return 1;
+
+    wstring fullPathName;
+    wstring format;
+    while (ReadMessage(jobPipe, &buf)) {
+        Pickle job(&buf[0], static_cast<int>(buf.size()));
+        void* iter = NULL;
+        if (!job.ReadWString(&iter, &fullPathName))
+            return 1;
+
+        bool identified = false;
+        PersistentMap::MediaInfo info;
+        try {
+            int sampleRate;
+            int bitrate;
+            int channels;
+            int cutoff;
+            int64 duration;
+            identified = ident.Identify(fullPathName, &sampleRate, &bitrate,
+                                        &channels, &cutoff, &duration,
+                                        &format);
+            if (identified)
+                info = PersistentMap::MediaInfo(sampleRate, bitrate, channels,
+                                                cutoff, duration, format);
+        } catch (const std::exception&) {
+            identified = true;
+            info = PersistentMap::MediaInfo(0, 0, 0, 0, 0,
+                                            wstring(L"[Crash]"));
+        }
+
+        Pickle result;
+        result.WriteBool(identified);
+        if (identified)
+            WriteMediaInfo(info, &result);
+
+        if (!WriteMessage(resultPipe, result))
+            return 1;
+    }
+
+    return 0;
+}
+
+bool WorkerProcess::Launch()
+{
+    HANDLE jobRead = NULL;
+    HANDLE jobWrite = NULL;
+    if (!CreatePipe(&jobRead, &jobWrite, NULL, 0))
+        return false;
+
+    // Anonymous pipes cannot be read asynchronously. The child writes to its
+    // end as to any other pipe.
+    HANDLE readEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    HANDLE resultRead = INVALID_HANDLE_VALUE;
+    HANDLE resultWrite = INVALID_HANDLE_VALUE;
+    if (readEvent) {
+        AutoLock lock(launchLock.Get());
+        const wstring name = L"\\\\.\\pipe\\audio_quality_identification." +
+            base::UintToString16(base::GetCurrentProcId()) + L"." +
+            base::Int64ToString16(pipeCount++);
+        resultRead = CreateNamedPipe(
+            name.c_str(),
+            PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED |
+                FILE_FLAG_FIRST_PIPE_INSTANCE,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, 1,
+            resultPipeBufferSize, resultPipeBufferSize, 0, NULL);
+        if (resultRead != INVALID_HANDLE_VALUE)
+            resultWrite = CreateFile(name.c_str(), GENERIC_WRITE, 0, NULL,
+                                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                                     NULL);
+    }
+
+    if (resultWrite == INVALID_HANDLE_VALUE) {
+        if (resultRead != INVALID_HANDLE_VALUE)
+            CloseHandle(resultRead);
+
+        if (readEvent)
+            CloseHandle(readEvent);
+
+        CloseHandle(jobRead);
+        CloseHandle(jobWrite);
+        return false;
+    }
+
+    unique_ptr<wchar_t[]> buf(new wchar_t[MAX_PATH]);
+    GetModuleFileName(NULL, buf.get(), MAX_PATH);
+    CommandLine commandLine((FilePath(buf.get())));
+    commandLine.AppendSwitch(identifyWorkerSwitch);
+    commandLine.AppendSwitchASCII(jobPipeSwitch, HandleToString(jobRead));
+    commandLine.AppendSwitchASCII(resultPipeSwitch,
+                                  HandleToString(resultWrite));
+
+    base::LaunchOptions launchOptions;
+    launchOptions.inherit_handles = true;
+    launchOptions.start_hidden = true;
+    bool launched;
+    {
+        // The child's ends are only inheritable while it is being created,
+        // and are closed here before the next child is. Had another child
+        // inherited them, a crash would go unnoticed until that one exits.
+        AutoLock lock(launchLock.Get());
+        SetHandleInformation(jobRead, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+        SetHandleInformation(resultWrite, HANDLE_FLAG_INHERIT,
+                             HANDLE_FLAG_INHERIT);
+        launched = base::LaunchProcess(commandLine, launchOptions, &process_);
+        CloseHandle(jobRead);
+        CloseHandle(resultWrite);
+    }
+
+    if (!launched) {
+        process_ = base::kNullProcessHandle;
+        CloseHandle(jobWrite);
+        CloseHandle(resultRead);
+        CloseHandle(readEvent);
+        return false;
+    }
+
+    jobPipe_ = jobWrite;
+    resultPipe_ = resultRead;
+    readEvent_ = readEvent;
+    return true;
+}
+
+void WorkerProcess::Kill()
+{
+    if (process_) {
+        base::KillProcess(process_, killedExitCode, true);
+        base::CloseProcessHandle(process_);
+        process_ = base::kNullProcessHandle;
+    }
+
+    if (jobPipe_) {
+        CloseHandle(jobPipe_);
+        jobPipe_ = NULL;
+    }
+
+    if (resultPipe_) {
+        CloseHandle(resultPipe_);
+        resultPipe_ = NULL;
+    }
+
+    if (readEvent_) {
+        CloseHandle(readEvent_);
+        readEvent_ = NULL;
+    }
+}
+
+bool WorkerProcess::Receive(int timeout)
+{
+    const TimeTicks deadline =
+        TimeTicks::Now() + TimeDelta::FromSeconds(timeout);
+    uint32 size = 0;
+    if (!Read(reinterpret_cast<char*>(&size), sizeof(size), deadline) ||
+        !size)
+        return false;
+
+    buf_.resize(size);
+    return Read(&buf_[0], size, deadline);
+}
+
+bool WorkerProcess::Read(char* data, uint32 size, const TimeTicks& deadline)
+{
+    while (size) {
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.hEvent = readEvent_;
+        DWORD read = 0;
+        if (!ReadFile(resultPipe_, data, size, NULL, &overlapped)) {
+            if (GetLastError() != ERROR_IO_PENDING)
+                return false;
+
+            // The buffer must stay alive until the system is done with it.
+            if (!WaitForRead(deadline)) {
+                CancelIo(resultPipe_);
+                GetOverlappedResult(resultPipe_, &overlapped, &read, TRUE);
+                return false;
+            }
+        }
+
+        // A child that has exited fails the read with a broken pipe.
+        if (!GetOverlappedResult(resultPipe_, &overlapped, &read, FALSE) ||
+            !read)
+            return false;
+
+        data += read;
+        size -= read;
+    }
+
+    return true;
+}
+
+bool WorkerProcess::WaitForRead(const TimeTicks& deadline)
+{
+    HANDLE handles[] = { readEvent_, process_ };
+    for (;;) {
+        const int64 left = (deadline - TimeTicks::Now()).InMilliseconds();
+        if ((cancelFlag_ && cancelFlag_->IsSet()) || (left <= 0))
+            return false;
+
+        // The read is the first handle and wins if both are signaled, so a
+        // message written just before the child exited is not lost.
+        const DWORD wait = WaitForMultipleObjects(
+            arraysize(handles), handles, FALSE,
+            static_cast<DWORD>(min<int64>(left, cancelCheckInterval)));
+        if (wait == WAIT_OBJECT_0)
+            return true;
+
+        if (wait != WAIT_TIMEOUT)
+            return false;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef _WORKER_PROCESS_H_
+#define _WORKER_PROCESS_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_quality_ident.h"
+#include "persistent_map.h"
+#include "third_party/chromium/base/basictypes.h"
+#include "third_party/chromium/base/process.h"
+#include "third_party/chromium/base/synchronization/cancellation_flag.h"
+#include "third_party/chromium/base/time.h"
+
+//------------------------------------------------------------------------------
+// Runs AudioQualityIdent in a child process of this executable, so that a
+// decoder crashing on a corrupt file only takes the child down. Files and
+// results travel over a pair of pipes as Pickles, one file at a time. The
+// results come through a named pipe read with overlapped I/O, so the parent
+// wakes as soon as a result arrives or the child dies. A child that crashes,
+// or spends more than |timeout| seconds on one file, is killed and the file
+// reported as [Crash]. The next file starts a fresh child.
+class CommandLine;
+class WorkerProcess
+{
+public:
+    // Switch that makes the executable run RunChild() instead of the UI.
+    static const char identifyWorkerSwitch[];
+
+    WorkerProcess(const AudioQualityIdent::Options& options, int timeout,
+                  const std::shared_ptr<base::CancellationFlag>& cancelFlag);
+    ~WorkerProcess();
+
+    // Launches the child and waits until it has loaded its decoders.
+    bool Start();
+
+    // Returns false if the file is not supported, or the scan has been
+    // cancelled meanwhile.
+    bool Identify(const std::wstring& fullPathName,
+                  PersistentMap::MediaInfo* info);
+
+    // Entry point of the child. Serves files until the parent closes the
+    // pipes, and returns the exit code.
+    static int RunChild(const CommandLine& commandLine);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(WorkerProcess);
+
+    bool Launch();
+    void Kill();
+
+    // Waits up to |timeout| seconds for the next message from the child and
+    // leaves it in |buf_|. Fails as soon as the child exits or the scan is
+    // cancelled.
+    bool Receive(int timeout);
+    bool Read(char* data, uint32 size, const base::TimeTicks& deadline);
+
+    // Waits for the read in flight to complete. False on a timeout or a
+    // cancellation, the read is still pending then.
+    bool WaitForRead(const base::TimeTicks& deadline);
+
+    AudioQualityIdent::Options options_;
+    int timeout_;
+    std::shared_ptr<base::CancellationFlag> cancelFlag_;
+    base::ProcessHandle process_;
+    void* jobPipe_;
+    void* resultPipe_;
+    void* readEvent_;
+
+    // Keeps its capacity across files.
+    std::vector<char> buf_;
+};
+
+#endif  // _WORKER_PROCESS_H_